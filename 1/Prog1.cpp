@@ -1,162 +1,376 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <utility>
+#include <vector>
+#include <unistd.h>
 #include "Prog1.h"
+#include "Prog1io.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1pipeline.h"
+#include "Prog1stats.h"
 
 namespace Prog1 {
-    
+    namespace {
+        template<class V, class I>
+        int parts_for(const BasicCSR<V, I>& coord) {
+            return static_cast<std::size_t>(coord.msize) < parallel_min_nnz ? 1 : thread_count();
+        }
+    }
 
- 
 
 
     CSR input() {
-        CSR coord;
-        int* help_row;
-        try {
-            int msize{0}, row{0};
-            std::cout << "Enter size of matrix (format: row * column):" << std::endl;
-            row = getNum<int>();
-            coord.row = row;
-            coord.col = getNum<int>();
-            std::cout << "Enter number of elements != 0" << std::endl;
-            msize = getNum<int>();
-            coord.msize = msize;
-            help_row = new int[msize];
-            coord.arr_col = new int[msize]();
-            coord.arr_row = new int[row + 1]();
-            coord.arr_val = new int[msize]();
-            coord.arr_row[0] = 0;
+        // piped or redirected input: no prompts, one bulk read (timed by the reader). Typed input is not
+        // timed, the time would be the user's
+        if (!::isatty(STDIN_FILENO)) {
+            NumberReader in = NumberReader::from_stdin();
+            return read_csr_text<int, int>(in);
+        }
+        int msize{0}, row{0}, col{0};
+        std::cout << "Enter size of matrix (format: row * column):" << std::endl;
+        row = getNum<int>(0);
+        col = getNum<int>(0);
+        std::cout << "Enter number of elements != 0" << std::endl;
+        msize = getNum<int>(0);
+        std::vector<int> help_row(msize), help_col(msize), help_val(msize);
+        
+        for (int i = 0; i < msize; i++) {
             
-            for (int i = 0; i < coord.msize; i++) {
-                
-                std::cout << "Enter column coord (start with 0): " << std::endl;
-                coord.arr_col[i] = getNum<int>();
-                while (coord.arr_col[i] > coord.col || coord.arr_col[i] < 0) {
-                    std::cout << "Incorrect! Repeat pls" << std::endl;
-                    coord.arr_col[i] = getNum<int>();
-                } 
-                std::cout << "Enter row coord (start with 0): " << std::endl;
+            std::cout << "Enter column coord (start with 0): " << std::endl;
+            help_col[i] = getNum<int>();
+            while (help_col[i] >= col || help_col[i] < 0) {
+                std::cout << "Incorrect! Repeat pls" << std::endl;
+                help_col[i] = getNum<int>();
+            } 
+            std::cout << "Enter row coord (start with 0): " << std::endl;
+            help_row[i] = getNum<int>();
+            while (help_row[i] >= row || help_row[i] < 0) {
+                std::cout << "Incorrect! Repeat pls" << std::endl;
                 help_row[i] = getNum<int>();
-                while (help_row[i] > coord.col || help_row[i] < 0) {
-                    std::cout << "Incorrect! Repeat pls" << std::endl;
-                    help_row[i] = getNum<int>();
-                }
-                
-                std::cout << "Enter value: " << std::endl;
-                coord.arr_val[i] = getNum<int>();
-            }
-
-            for (int i = 0; i < coord.msize; i++) {
-                for (int j = 0; j < coord.msize - 1; j++) {
-                    if (help_row[j] > help_row[j + 1]) {
-                        int tmp1 = help_row[j];
-                        help_row[j] = help_row[j + 1];
-                        help_row[j + 1] = tmp1;
-                        
-                        tmp1 = coord.arr_col[j];
-                        coord.arr_col[j] = coord.arr_col[j + 1];
-                        coord.arr_col[j + 1] = tmp1;
-                        
-                        tmp1 = coord.arr_val[j];
-                        coord.arr_val[j] = coord.arr_val[j + 1];
-                        coord.arr_val[j + 1] = tmp1;
-                    }
-                }
             }
             
-            for(int i = 0; i < coord.row; i++){
-                int count{0}; 
-                for (int j = 0; j < coord.msize; j++) {
-                    if(help_row[j] == i){
-                        count++;
+            std::cout << "Enter value: " << std::endl;
+            help_val[i] = getNum<int>();
+        }
+
+        return build_csr_from_coo(row, col, help_row.data(), help_col.data(), help_val.data(), msize);
+    }
+
+
+
+    namespace {
+        // CSR with the elements in input order inside every row, in O(nnz + rows)
+        template<class V, class I>
+        BasicCSR<V, I> bucket_by_row(I rows, I cols, const I* row_idx, const I* col_idx, const V* vals, I nnz) {
+            BasicCSR<V, I> coord;
+            coord.allocate(rows, nnz);
+            coord.col = cols;
+            I* arr_row = coord.arr_row.data();
+            std::fill_n(arr_row, static_cast<std::size_t>(rows) + 1, I{ 0 });
+
+            // 1st pass: elements per row, then exclusive prefix sum -> start of each row
+            for (I k = 0; k < nnz; k++) {
+                arr_row[row_idx[k] + 1]++;
+            }
+            for (I i = 0; i < rows; i++) {
+                arr_row[i + 1] += arr_row[i];
+            }
+
+            // 2nd pass: scatter, arr_row[r] is used as the insertion cursor of row r
+            for (I k = 0; k < nnz; k++) {
+                I pos = arr_row[row_idx[k]]++;
+                coord.arr_col[pos] = col_idx[k];
+                coord.arr_val[pos] = vals[k];
+            }
+
+            // cursors now hold the end of each row, shift them back to the starts
+            for (I i = rows; i > 0; i--) {
+                arr_row[i] = arr_row[i - 1];
+            }
+            arr_row[0] = 0;
+
+            return coord;
+        }
+
+        // COO element with (row, col) packed into one key, the row in the high bits
+        template<class V>
+        struct KeyedValue {
+            std::uint64_t key;
+            V val;
+        };
+
+        template<class V>
+        V combine_duplicate(V acc, V x, Duplicates dup) {
+            switch (dup) {
+            case Duplicates::sum:
+                return acc + x;
+            case Duplicates::max:
+                return acc < x ? x : acc;
+            default:
+                return x;
+            }
+        }
+
+        // stable LSD radix sort by the low key_bits bits of the keys, 8 bits per pass; every part of the
+        // array counts its digits, the counts are laid out digit-major, then each part scatters its elements.
+        // Passes over a digit that all keys share are skipped
+        template<class V>
+        void radix_sort(AlignedBuffer<KeyedValue<V>>& a, int key_bits) {
+            const std::size_t n = a.size();
+            const int buckets = 256;
+            int parts = n < parallel_min_nnz ? 1 : thread_count();
+            auto chunk = [&](int p) { return n * p / parts; };
+            AlignedBuffer<KeyedValue<V>> tmp(n);
+            std::vector<std::size_t> hist(static_cast<std::size_t>(parts) * buckets);
+
+            for (int shift = 0; shift < key_bits; shift += 8) {
+                std::fill(hist.begin(), hist.end(), 0);
+                parallel_for(parts, [&](int p) {
+                    std::size_t* h = hist.data() + static_cast<std::size_t>(p) * buckets;
+                    for (std::size_t k = chunk(p); k < chunk(p + 1); k++) {
+                        h[(a[k].key >> shift) & 0xFF]++;
+                    }
+                });
+                std::size_t pos{ 0 };
+                bool one_bucket = false;
+                for (int b = 0; b < buckets; b++) {
+                    std::size_t start = pos;
+                    for (int p = 0; p < parts; p++) {
+                        std::size_t count = hist[static_cast<std::size_t>(p) * buckets + b];
+                        hist[static_cast<std::size_t>(p) * buckets + b] = pos;
+                        pos += count;
                     }
+                    one_bucket = one_bucket || pos - start == n;
                 }
-                coord.arr_row[i + 1] = count;
+                if (one_bucket) {
+                    continue;
+                }
+                parallel_for(parts, [&](int p) {
+                    std::size_t* cursor = hist.data() + static_cast<std::size_t>(p) * buckets;
+                    for (std::size_t k = chunk(p); k < chunk(p + 1); k++) {
+                        tmp[cursor[(a[k].key >> shift) & 0xFF]++] = a[k];
+                    }
+                });
+                std::swap(a, tmp);
             }
+        }
+    }
+
+
 
-            for (int i = 0; i < coord.row; i++) {
-                coord.arr_row[i + 1] += coord.arr_row[i];
+    template<class V, class I>
+    BasicCSR<V, I> build_csr_from_coo(std::type_identity_t<I> rows, std::type_identity_t<I> cols,
+                                      const I* row_idx, const I* col_idx, const V* vals, std::type_identity_t<I> nnz,
+                                      Duplicates dup) {
+        PROG1_STATS_TIMER(build);
+        if (rows < 0 || cols < 0 || nnz < 0 || rows == std::numeric_limits<I>::max()) {
+            throw std::runtime_error("Invalid matrix size");
+        }
+        for (I k = 0; k < nnz; k++) {
+            if (row_idx[k] < 0 || row_idx[k] >= rows || col_idx[k] < 0 || col_idx[k] >= cols) {
+                throw std::runtime_error("Element coordinates out of range");
             }
-            delete[] help_row;
+        }
+
+        const int col_bits = std::bit_width(static_cast<std::uint64_t>(cols > 0 ? cols - 1 : 0));
+        const int row_bits = std::bit_width(static_cast<std::uint64_t>(rows > 0 ? rows - 1 : 0));
+        const std::size_t n = static_cast<std::size_t>(nnz);
+        int parts = n < parallel_min_nnz ? 1 : thread_count();
+        auto chunk = [&](int p) { return n * p / parts; };
 
+        // input already in (row, col) order (a written CSR, a generated band) needs no sort;
+        // neither does (row, col) that does not fit one key (only with 64-bit indices). Both go
+        // through a counting sort by row, which keeps the order inside rows
+        std::vector<char> part_sorted(parts);
+        parallel_for(parts, [&](int p) {
+            bool sorted = true;
+            for (std::size_t k = std::max<std::size_t>(chunk(p), 1); sorted && k < chunk(p + 1); k++) {
+                sorted = row_idx[k - 1] < row_idx[k] || (row_idx[k - 1] == row_idx[k] && col_idx[k - 1] <= col_idx[k]);
+            }
+            part_sorted[p] = sorted;
+        });
+        bool in_key_order = std::find(part_sorted.begin(), part_sorted.end(), 0) == part_sorted.end();
+        if (in_key_order || row_bits + col_bits > 64) {
+            BasicCSR<V, I> coord = bucket_by_row(rows, cols, row_idx, col_idx, vals, nnz);
+            canonicalize(coord, dup);
+            PROG1_STATS_ADD(elements_built, coord.msize);
+            return coord;
         }
-        catch (...) {
-            erase(coord);
-            delete[] help_row;
-            throw;
+
+        AlignedBuffer<KeyedValue<V>> a(n);
+        parallel_for(parts, [&](int p) {
+            for (std::size_t k = chunk(p); k < chunk(p + 1); k++) {
+                std::uint64_t row_key = col_bits == 64 ? 0 : static_cast<std::uint64_t>(row_idx[k]) << col_bits;
+                a[k] = { row_key | static_cast<std::uint64_t>(col_idx[k]), vals[k] };
+            }
+        });
+        radix_sort(a, row_bits + col_bits);
+
+        // parts start at a new key, so equal keys are combined inside one part
+        std::vector<std::size_t> bounds(parts + 1);
+        for (int p = 0; p <= parts; p++) {
+            std::size_t b = std::max(chunk(p), p > 0 ? bounds[p - 1] : 0);
+            while (b > 0 && b < n && a[b].key == a[b - 1].key) {
+                b++;
+            }
+            bounds[p] = b;
         }
-        
+        std::vector<I> part_size(parts + 1, 0);
+        parallel_for(parts, [&](int p) {
+            I count{ 0 };
+            for (std::size_t k = bounds[p]; k < bounds[p + 1]; k++) {
+                count += k == bounds[p] || a[k].key != a[k - 1].key;
+            }
+            part_size[p + 1] = count;
+        });
+        for (int p = 0; p < parts; p++) {
+            part_size[p + 1] += part_size[p];
+        }
+
+        PROG1_STATS_ADD(duplicates_merged, n - static_cast<std::size_t>(part_size[parts]));
+        PROG1_STATS_ADD(elements_built, part_size[parts]);
+        BasicCSR<V, I> coord;
+        coord.allocate(rows, part_size[parts]);
+        coord.col = cols;
+        const std::uint64_t col_mask = col_bits == 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << col_bits) - 1;
+        auto row_of = [&](std::size_t k) { return static_cast<I>(col_bits == 64 ? 0 : a[k].key >> col_bits); };
+        parallel_for(parts, [&](int p) {
+            I pos = part_size[p] - 1;
+            // rows after the last element of the previous parts start here
+            I next_row = bounds[p] > 0 ? row_of(bounds[p] - 1) + 1 : 0;
+            for (std::size_t k = bounds[p]; k < bounds[p + 1]; k++) {
+                if (k > bounds[p] && a[k].key == a[k - 1].key) {
+                    coord.arr_val[pos] = combine_duplicate(coord.arr_val[pos], a[k].val, dup);
+                    continue;
+                }
+                pos++;
+                for (I r = row_of(k); next_row <= r; next_row++) {
+                    coord.arr_row[next_row] = pos;
+                }
+                coord.arr_col[pos] = static_cast<I>(a[k].key & col_mask);
+                coord.arr_val[pos] = a[k].val;
+            }
+            if (p == parts - 1) {
+                for (; next_row <= rows; next_row++) {
+                    coord.arr_row[next_row] = coord.msize;
+                }
+            }
+        });
         return coord;
     }
 
 
 
-    void specialfunc(CSR& coord) {
-        //���������� �� �����
-        for (int i = 0; i < coord.row; i++) {
-            for (int j = coord.arr_row[i]; j < coord.arr_row[i + 1]; j++) {
-                for (int m = coord.arr_row[i]; j < coord.arr_row[i + 1] - 1; j++) {
-                    if (coord.arr_col[m] > coord.arr_col[m + 1]) {
-                        int tmp1 = coord.arr_col[m];
-                        coord.arr_col[m] = coord.arr_col[m + 1];
-                        coord.arr_col[m + 1] = tmp1;
-                        int tmp2 = coord.arr_val[m] ;
-                        coord.arr_val[m] = coord.arr_val[m + 1];
-                        coord.arr_val[m + 1] = tmp2;
-                    }
-                }
+
+    namespace {
+        // stable sort of one row by column; scratch is reused between rows
+        template<class V, class I>
+        void sort_row(BasicCSR<V, I>& coord, I i, std::vector<std::pair<I, V>>& scratch) {
+            I begin = coord.arr_row[i], end = coord.arr_row[i + 1];
+            if (std::is_sorted(coord.arr_col.data() + begin, coord.arr_col.data() + end)) {
+                return;
+            }
+            scratch.clear();
+            for (I j = begin; j < end; j++) {
+                scratch.emplace_back(coord.arr_col[j], coord.arr_val[j]);
+            }
+            std::stable_sort(scratch.begin(), scratch.end(),
+                             [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (I j = begin; j < end; j++) {
+                coord.arr_col[j] = scratch[j - begin].first;
+                coord.arr_val[j] = scratch[j - begin].second;
             }
         }
-        //�������� ��������� �� �������
-        int count{ 0 };
-        for (int i = 0; i < coord.row; i++) {
-            if (coord.arr_row[i] == coord.arr_row[i + 1]) {
-                continue;
+    }
+
+
+    template<class V, class I>
+    void sort_rows(BasicCSR<V, I>& coord) {
+        int parts = parts_for(coord);
+        std::vector<I> bounds = partition_rows(coord, parts);
+        parallel_for(parts, [&](int p) {
+            std::vector<std::pair<I, V>> scratch;
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                sort_row(coord, i, scratch);
             }
-            int min = coord.arr_val[coord.arr_row[i]];
-            int index = coord.arr_row[i];
-            //����� ��������
-            for (int j = coord.arr_row[i]; j < coord.arr_row[i + 1]; j++) {
-                if (coord.arr_val[j] < min) {
-                    min = coord.arr_val[j];
-                    index = j;
+        });
+    }
+
+    template<class V, class I>
+    void canonicalize(BasicCSR<V, I>& coord, Duplicates dup) {
+        PROG1_STATS_TIMER(build);
+        sort_rows(coord);
+        int parts = parts_for(coord);
+        std::vector<I> bounds = partition_rows(coord, parts);
+        std::vector<I> part_size(parts + 1, 0);
+        BasicCSR<V, I> result;
+        result.allocate(coord.row, 0);
+        result.col = coord.col;
+        I* new_row = result.arr_row.data();
+
+        // 1st phase: distinct columns of every row
+        parallel_for(parts, [&](int p) {
+            I total{ 0 };
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                I count{ 0 };
+                for (I k = coord.arr_row[i]; k < coord.arr_row[i + 1]; k++) {
+                    count += k == coord.arr_row[i] || coord.arr_col[k] != coord.arr_col[k - 1];
                 }
+                new_row[i + 1] = count;
+                total += count;
             }
-            //���� ��������
-            for (int j = coord.arr_row[i]; j < index; j++) {
-                if (coord.arr_val[j] > min) {
-                    for (int m = j; m < coord.msize - 1; m++) {
-                        coord.arr_col[m] = coord.arr_col[m + 1];
-                        coord.arr_val[m] = coord.arr_val[m + 1];
-                    }
-                    for (int m = i; m < coord.row; m++) {
-                        coord.arr_row[m + 1] = coord.arr_row[m + 1] - 1;
+            part_size[p + 1] = total;
+        });
+        for (int p = 0; p < parts; p++) {
+            part_size[p + 1] += part_size[p];
+        }
+        if (part_size[parts] == coord.msize) {
+            return; // nothing repeated
+        }
+        PROG1_STATS_ADD(duplicates_merged, coord.msize - part_size[parts]);
+        result.resize_nnz(part_size[parts]); // may move the arena
+        new_row = result.arr_row.data();
+
+        // 2nd phase: row offsets and the combined elements
+        new_row[0] = 0;
+        parallel_for(parts, [&](int p) {
+            I pos = part_size[p];
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                for (I k = coord.arr_row[i]; k < coord.arr_row[i + 1]; k++) {
+                    if (k > coord.arr_row[i] && coord.arr_col[k] == coord.arr_col[k - 1]) {
+                        result.arr_val[pos - 1] = combine_duplicate(result.arr_val[pos - 1], coord.arr_val[k], dup);
+                    } else {
+                        result.arr_col[pos] = coord.arr_col[k];
+                        result.arr_val[pos] = coord.arr_val[k];
+                        pos++;
                     }
-                    count++;  
                 }
-            }  
-        }
-        int* tmp1 = new int[coord.msize - count];
-        std::copy(coord.arr_val, coord.arr_val + coord.msize - count, tmp1);
-        delete[] coord.arr_val;
-        coord.arr_val = tmp1;
-        int* tmp2 = new int[coord.msize - count];
-        std::copy(coord.arr_col, coord.arr_col + coord.msize - count, tmp2);
-        delete[] coord.arr_col;
-        coord.arr_col = tmp2;
-        coord.msize = coord.msize - count;
+                new_row[i + 1] = pos;
+            }
+        });
+
+        coord = std::move(result);
     }
-    
 
 
 
-    void erase(CSR& coord) {
-        delete[] coord.arr_col;
-        delete[] coord.arr_row;
-        delete[] coord.arr_val;
-        coord.col = 0;
-        coord.row = 0;
-        coord.msize = 0;
+    template<class V, class I>
+    void specialfunc(BasicCSR<V, I>& coord) {
+        PROG1_STATS_TIMER(filter);
+        // in every row drops the elements to the left of the (first) row minimum that are greater than it,
+        // i.e. keeps the segment from the minimum to the end of the row; rows are independent
+        sort_rows(coord);
+        coord = coord | drop_before_argmin() | compact();
     }
 
+
+
+
+
    /* int** initMatr(int row, int col) {
         int** arr = new int* [row]();
         for (int i = 0; i < row; i++) {
@@ -204,32 +418,110 @@ namespace Prog1 {
     }*/
 
 
-    int get_value(CSR& coord, int row, int col){
-        for(int i = coord.arr_row[row]; i < coord.arr_row[row + 1]; i++){
-            if(coord.arr_col[i] == col){
-                return coord.arr_val[i];
-            }
+    template<class V, class I>
+    V get_value(const BasicCSR<V, I>& coord, std::type_identity_t<I> row, std::type_identity_t<I> col){
+        return get_value(CSRView<V, I>(coord), row, col);
+    }
+
+    template<class V, class I>
+    V get_value(const CSRView<V, I>& view, std::type_identity_t<I> row, std::type_identity_t<I> col){
+        // columns are sorted inside a row, so this is a binary search
+        const I* begin = view.arr_col + view.row_begin(row);
+        const I* end = view.arr_col + view.row_end(row);
+        const I* it = std::lower_bound(begin, end, col);
+        if (it != end && *it == col) {
+            return view.arr_val[it - view.arr_col];
         }
         return 0;
     }
 
 
-    void output(CSR& coord){
-        for(int i = 0; i < coord.row; i++){
-            for(int j = 0; j < coord.col; j++){
-                int value = get_value(coord, i, j);
-                std::cout << value << "\t";
-            }
-            std::cout << std::endl;
-        }
+    template<class V, class I>
+    void output(const BasicCSR<V, I>& coord){
+        write_dense(coord, std::cout);
+    }
 
+    template<class V, class I>
+    void output(const CSRView<V, I>& view){
+        write_dense(view, std::cout);
     }
 
 
+    template<class V, class I>
+    void write_dense(const BasicCSR<V, I>& coord, std::ostream& out){
+        write_dense(CSRView<V, I>(coord), out);
+    }
 
-    
-   
-}
+    template<class V, class I>
+    void write_dense(const CSRView<V, I>& view, std::ostream& out){
+        PROG1_STATS_TIMER(output);
+        const std::size_t capacity = 1 << 20;
+        const std::size_t max_cell = 32; // longest shortest-form double plus '\t'
+        std::vector<char> buffer(capacity);
+        char* buf = buffer.data();
+        std::size_t used{ 0 };
+        auto flush = [&]() {
+            PROG1_STATS_ADD(output_bytes, used);
+            out.write(buf, static_cast<std::streamsize>(used));
+            used = 0;
+        };
+        // runs of zero cells are copied from a ready-made "0\t0\t..." block
+        const std::size_t zero_block = 4096;
+        std::vector<char> zeros(2 * zero_block);
+        for (std::size_t j = 0; j < zero_block; j++) {
+            zeros[2 * j] = '0';
+            zeros[2 * j + 1] = '\t';
+        }
+        auto put_zeros = [&](std::size_t count) {
+            while (count > 0) {
+                std::size_t n = std::min(count, zero_block);
+                if (used + 2 * n > capacity) {
+                    flush();
+                }
+                std::memcpy(buf + used, zeros.data(), 2 * n);
+                used += 2 * n;
+                count -= n;
+            }
+        };
 
+        for (I i = 0; i < view.row; i++) {
+            I next_col{ 0 };
+            for (I k = view.row_begin(i); k < view.row_end(i); k++) {
+                I j = view.arr_col[k];
+                if (j < next_col) {
+                    continue; // repeated column, the first one wins as in get_value
+                }
+                put_zeros(j - next_col);
+                if (used + max_cell > capacity) {
+                    flush();
+                }
+                used = std::to_chars(buf + used, buf + capacity, view.arr_val[k]).ptr - buf;
+                buf[used++] = '\t';
+                next_col = j + 1;
+            }
+            put_zeros(view.col - next_col);
+            if (used + 1 > capacity) {
+                flush();
+            }
+            buf[used++] = '\n';
+        }
+        flush();
+        out.flush();
+    }
 
 
+
+#define PROG1_INSTANTIATE(V, I) \
+    template BasicCSR<V, I> build_csr_from_coo<V, I>(I, I, const I*, const I*, const V*, I, Duplicates); \
+    template void sort_rows<V, I>(BasicCSR<V, I>&); \
+    template void canonicalize<V, I>(BasicCSR<V, I>&, Duplicates); \
+    template void specialfunc<V, I>(BasicCSR<V, I>&); \
+    template V get_value<V, I>(const BasicCSR<V, I>&, I, I); \
+    template V get_value<V, I>(const CSRView<V, I>&, I, I); \
+    template void output<V, I>(const BasicCSR<V, I>&); \
+    template void output<V, I>(const CSRView<V, I>&); \
+    template void write_dense<V, I>(const BasicCSR<V, I>&, std::ostream&); \
+    template void write_dense<V, I>(const CSRView<V, I>&, std::ostream&);
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
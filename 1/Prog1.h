@@ -5,15 +5,153 @@
 #include <string>
 #include <limits>
 #include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "Prog1buffer.h"
 
 namespace Prog1 {
-    struct CSR {
-        int* arr_val = nullptr; // 
-        int* arr_col = nullptr; //  
-        int* arr_row = nullptr; //  
-        int col{ 0 }, row{ 0 }, msize{ 0 };
+    // CSR matrix: the elements of row i are arr_col/arr_val[arr_row[i] .. arr_row[i + 1]),
+    // kept in column order without repeated columns. Owns its arrays, so it can only be moved (or clone()d).
+    // allocate() puts all three arrays into one arena: arr_row, then arr_col, then arr_val,
+    // each 64-byte aligned; the arrays may also borrow memory (see CSRMapped)
+    template<class ValueT, class IndexT>
+    struct BasicCSR {
+        using value_type = ValueT;
+        using index_type = IndexT;
+
+        AlignedBuffer<ValueT> arr_val; // 
+        AlignedBuffer<IndexT> arr_col; //  
+        AlignedBuffer<IndexT> arr_row; //  
+        IndexT col{ 0 }, row{ 0 }, msize{ 0 };
+        Arena storage;
+
+        BasicCSR() = default;
+        BasicCSR(BasicCSR&& other) noexcept
+            : arr_val(std::move(other.arr_val)), arr_col(std::move(other.arr_col)), arr_row(std::move(other.arr_row)),
+              col(std::exchange(other.col, 0)), row(std::exchange(other.row, 0)), msize(std::exchange(other.msize, 0)),
+              storage(std::move(other.storage)) {}
+        BasicCSR& operator=(BasicCSR&& other) noexcept {
+            arr_val = std::move(other.arr_val);
+            arr_col = std::move(other.arr_col);
+            arr_row = std::move(other.arr_row);
+            col = std::exchange(other.col, 0);
+            row = std::exchange(other.row, 0);
+            msize = std::exchange(other.msize, 0);
+            storage = std::move(other.storage);
+            return *this;
+        }
+
+        // one block for rows + 1 row offsets and nnz elements (contents uninitialized); sets row and msize
+        void allocate(IndexT rows, IndexT nnz) {
+            std::size_t col_off = col_offset(rows);
+            std::size_t val_off = val_offset(col_off, nnz);
+            storage = Arena(val_off + static_cast<std::size_t>(nnz) * sizeof(ValueT));
+            row = rows;
+            msize = nnz;
+            attach(col_off, val_off);
+        }
+
+        // changes the number of elements keeping arr_row and the first min(msize, nnz) elements;
+        // the arena grows in place when it can
+        void resize_nnz(IndexT nnz) {
+            std::size_t col_off = col_offset(row);
+            std::size_t old_val_off = val_offset(col_off, msize);
+            std::size_t new_val_off = val_offset(col_off, nnz);
+            std::size_t keep = static_cast<std::size_t>(nnz < msize ? nnz : msize) * sizeof(ValueT);
+            storage.grow(new_val_off + static_cast<std::size_t>(nnz) * sizeof(ValueT));
+            if (keep > 0 && old_val_off != new_val_off) {
+                std::memmove(storage.data() + new_val_off, storage.data() + old_val_off, keep);
+            }
+            msize = nnz;
+            attach(col_off, new_val_off);
+        }
+
+        BasicCSR clone() const {
+            BasicCSR copy;
+            copy.allocate(row, msize);
+            copy.col = col;
+            std::memcpy(copy.arr_row.data(), arr_row.data(), arr_row.size() * sizeof(IndexT));
+            std::memcpy(copy.arr_col.data(), arr_col.data(), arr_col.size() * sizeof(IndexT));
+            std::memcpy(copy.arr_val.data(), arr_val.data(), arr_val.size() * sizeof(ValueT));
+            return copy;
+        }
+
+    private:
+        static std::size_t col_offset(IndexT rows) {
+            return align_up((static_cast<std::size_t>(rows) + 1) * sizeof(IndexT));
+        }
+        static std::size_t val_offset(std::size_t col_off, IndexT nnz) {
+            return align_up(col_off + static_cast<std::size_t>(nnz) * sizeof(IndexT));
+        }
+        void attach(std::size_t col_off, std::size_t val_off) {
+            char* base = storage.data();
+            arr_row = AlignedBuffer<IndexT>::borrow(reinterpret_cast<IndexT*>(base), static_cast<std::size_t>(row) + 1);
+            arr_col = AlignedBuffer<IndexT>::borrow(reinterpret_cast<IndexT*>(base + col_off), msize);
+            arr_val = AlignedBuffer<ValueT>::borrow(reinterpret_cast<ValueT*>(base + val_off), msize);
+        }
     };
 
+    // read-only view of the rows [first_row, first_row + row) of a BasicCSR, nothing is copied: arr_row points
+    // into the offsets of the matrix and arr_col / arr_val at its first element of the range, so the elements
+    // of row i of the view are arr_col/arr_val[row_begin(i) .. row_end(i)). Valid while the matrix lives and
+    // is not changed. Many views of one matrix can be used by different threads at once
+    template<class ValueT, class IndexT>
+    struct CSRView {
+        using value_type = ValueT;
+        using index_type = IndexT;
+
+        const IndexT* arr_row{ nullptr }; // row + 1 offsets of the matrix, not rebased
+        const IndexT* arr_col{ nullptr };
+        const ValueT* arr_val{ nullptr };
+        IndexT base{ 0 };                 // arr_row[0], subtracted from the offsets
+        IndexT first_row{ 0 };            // row of the matrix the view starts at
+        IndexT col{ 0 }, row{ 0 }, msize{ 0 };
+
+        CSRView() = default;
+        // the whole matrix
+        CSRView(const BasicCSR<ValueT, IndexT>& coord)
+            : arr_row(coord.arr_row.data()), arr_col(coord.arr_col.data()), arr_val(coord.arr_val.data()),
+              col(coord.col), row(coord.row), msize(coord.msize) {}
+        // rows [first, last) of coord
+        CSRView(const BasicCSR<ValueT, IndexT>& coord, IndexT first, IndexT last) : CSRView(coord) {
+            *this = rows(first, last);
+        }
+
+        IndexT row_begin(IndexT i) const { return arr_row[i] - base; }
+        IndexT row_end(IndexT i) const { return arr_row[i + 1] - base; }
+
+        // rows [first, last) of this view
+        CSRView rows(IndexT first, IndexT last) const {
+            if (first > last || last > row) {
+                throw std::runtime_error("Row range out of the matrix");
+            }
+            CSRView sub = *this;
+            if (row == 0) {
+                return sub; // a default constructed matrix has no offsets
+            }
+            sub.arr_row = arr_row + first;
+            sub.arr_col = arr_col + row_begin(first);
+            sub.arr_val = arr_val + row_begin(first);
+            sub.base = arr_row[first];
+            sub.first_row = first_row + first;
+            sub.row = last - first;
+            sub.msize = arr_row[last] - arr_row[first];
+            return sub;
+        }
+    };
+
+    // the matrix of the lab: int values, int indices
+    using CSR = BasicCSR<int, int>;
+
+    // value/index combinations the templated functions are compiled for
+#define PROG1_CSR_INSTANTIATIONS(X) \
+    X(int, int) X(int, std::uint32_t) X(int, std::uint64_t) \
+    X(std::int64_t, int) X(std::int64_t, std::uint32_t) X(std::int64_t, std::uint64_t) \
+    X(float, int) X(float, std::uint32_t) X(float, std::uint64_t) \
+    X(double, int) X(double, std::uint32_t) X(double, std::uint64_t)
+
 
 
     //     
@@ -42,14 +180,45 @@ namespace Prog1 {
 
     //  
     CSR input();
-    void specialfunc(CSR& coord);
-    void erase(CSR& coord);
+    // how elements with the same (row, col) are combined: summed, the largest kept or the last given kept
+    enum class Duplicates { sum, max, last };
+
+    // builds a canonical CSR (columns sorted in every row, no repeated (row, col)) from COO triples
+    // (row_idx[k], col_idx[k], vals[k]), k < nnz: parallel LSD radix sort of the packed (row, col) keys
+    // (skipped for input already in that order), then the repeated keys are combined by dup
+    template<class V, class I>
+    BasicCSR<V, I> build_csr_from_coo(std::type_identity_t<I> rows, std::type_identity_t<I> cols,
+                                      const I* row_idx, const I* col_idx, const V* vals, std::type_identity_t<I> nnz,
+                                      Duplicates dup = Duplicates::sum);
+    // stable sort of the elements of every row by column
+    template<class V, class I>
+    void sort_rows(BasicCSR<V, I>& coord);
+    // makes a CSR from elsewhere (e.g. an old binary file) canonical: sort_rows(), then dup on repeated columns
+    template<class V, class I>
+    void canonicalize(BasicCSR<V, I>& coord, Duplicates dup = Duplicates::sum);
+    template<class V, class I>
+    void specialfunc(BasicCSR<V, I>& coord);
+    template<class V, class I>
+    void erase(BasicCSR<V, I>& coord) {
+        coord = BasicCSR<V, I>();
+    }
     //int** initMatr(int row, int col);
     //void erase(int** arr, int row, int col);
     //void printMatr(int** arr, int row, int col);
     //void made_and_print(CSR& coord);
-    int get_value(CSR& coord, int row, int col);
-    void output(CSR& coord);
+    template<class V, class I>
+    V get_value(const BasicCSR<V, I>& coord, std::type_identity_t<I> row, std::type_identity_t<I> col);
+    template<class V, class I>
+    V get_value(const CSRView<V, I>& view, std::type_identity_t<I> row, std::type_identity_t<I> col);
+    template<class V, class I>
+    void output(const BasicCSR<V, I>& coord);
+    template<class V, class I>
+    void output(const CSRView<V, I>& view);
+    // dense matrix as tab separated text, one row per line, through a large buffer
+    template<class V, class I>
+    void write_dense(const BasicCSR<V, I>& coord, std::ostream& out);
+    template<class V, class I>
+    void write_dense(const CSRView<V, I>& view, std::ostream& out);
 }
 
 #endif //OOPPROG1_PROG1_H
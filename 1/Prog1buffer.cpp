@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+#include "Prog1buffer.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PROG1_HAVE_MMAP 1
+#include <sys/mman.h>
+#endif
+
+namespace Prog1 {
+    namespace {
+        const std::size_t huge_page = std::size_t{ 2 } << 20;
+
+#ifdef PROG1_HAVE_MMAP
+        char* map_block(std::size_t bytes) {
+            void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            ::madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            return static_cast<char*>(p);
+        }
+#endif
+    }
+
+    Arena::Arena(std::size_t bytes) {
+        if (bytes == 0) {
+            return;
+        }
+#ifdef PROG1_HAVE_MMAP
+        if (bytes >= map_threshold) {
+            capacity_ = align_up(bytes, huge_page);
+            data_ = map_block(capacity_);
+            mapped_ = true;
+            PROG1_STATS_ADD(bytes_allocated, capacity_);
+            return;
+        }
+#endif
+        capacity_ = align_up(bytes);
+        data_ = static_cast<char*>(::operator new(capacity_, std::align_val_t{ alignment }));
+        PROG1_STATS_ADD(bytes_allocated, capacity_);
+    }
+
+    Arena::Arena(Arena&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), capacity_(std::exchange(other.capacity_, 0)),
+          mapped_(std::exchange(other.mapped_, false)) {}
+
+    Arena& Arena::operator=(Arena&& other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = std::exchange(other.data_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            mapped_ = std::exchange(other.mapped_, false);
+        }
+        return *this;
+    }
+
+    Arena::~Arena() {
+        release();
+    }
+
+    void Arena::release() {
+        if (data_) {
+#ifdef PROG1_HAVE_MMAP
+            if (mapped_) {
+                ::munmap(data_, capacity_);
+            } else
+#endif
+            {
+                ::operator delete(data_, std::align_val_t{ alignment });
+            }
+        }
+        data_ = nullptr;
+        capacity_ = 0;
+        mapped_ = false;
+    }
+
+    void Arena::grow(std::size_t bytes) {
+        if (bytes <= capacity_) {
+            return;
+        }
+#if defined(PROG1_HAVE_MMAP) && defined(MREMAP_MAYMOVE)
+        if (mapped_) {
+            // pages are remapped, not copied, and stay in place when the address space after them is free
+            std::size_t capacity = align_up(bytes, huge_page);
+            void* p = ::mremap(data_, capacity_, capacity, MREMAP_MAYMOVE);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            ::madvise(p, capacity, MADV_HUGEPAGE);
+#endif
+            data_ = static_cast<char*>(p);
+            PROG1_STATS_ADD(bytes_allocated, capacity - capacity_);
+            capacity_ = capacity;
+            return;
+        }
+#endif
+        // grow geometrically so that repeated small growths stay cheap
+        Arena bigger(std::max(bytes, capacity_ + capacity_ / 2));
+        if (capacity_ > 0) {
+            std::memcpy(bigger.data_, data_, capacity_);
+        }
+        *this = std::move(bigger);
+    }
+}
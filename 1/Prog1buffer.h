@@ -0,0 +1,135 @@
+#ifndef OOPPROG1_PROG1BUFFER_H
+#define OOPPROG1_PROG1BUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Prog1stats.h"
+
+namespace Prog1 {
+    // 64-byte aligned array of trivially copyable T; owns its memory or borrows someone else's
+    template<class T>
+    class AlignedBuffer {
+        static_assert(std::is_trivially_copyable<T>::value, "AlignedBuffer holds plain numbers only");
+
+    public:
+        static constexpr std::size_t alignment = 64;
+
+        AlignedBuffer() = default;
+
+        // n elements, left uninitialized unless zero is set
+        explicit AlignedBuffer(std::size_t n, bool zero = false) : size_(n), owned_(true) {
+            if (n > 0) {
+                data_ = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ alignment }));
+                PROG1_STATS_ADD(bytes_allocated, n * sizeof(T));
+                if (zero) {
+                    std::memset(static_cast<void*>(data_), 0, n * sizeof(T));
+                }
+            }
+        }
+
+        // non-owning buffer over memory that outlives it (e.g. a file mapping)
+        static AlignedBuffer borrow(T* data, std::size_t n) {
+            AlignedBuffer b;
+            b.data_ = data;
+            b.size_ = n;
+            return b;
+        }
+
+        AlignedBuffer(const AlignedBuffer&) = delete;
+        AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+        AlignedBuffer(AlignedBuffer&& other) noexcept
+            : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+              owned_(std::exchange(other.owned_, false)) {}
+
+        AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+            if (this != &other) {
+                release();
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+                owned_ = std::exchange(other.owned_, false);
+            }
+            return *this;
+        }
+
+        ~AlignedBuffer() { release(); }
+
+        // deep copy, always owning
+        AlignedBuffer clone() const {
+            AlignedBuffer b(size_);
+            if (size_ > 0) {
+                std::memcpy(static_cast<void*>(b.data_), data_, size_ * sizeof(T));
+            }
+            return b;
+        }
+
+        T* data() { return data_; }
+        const T* data() const { return data_; }
+        std::size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        bool owned() const { return owned_; }
+
+        T& operator[](std::size_t i) { return data_[i]; }
+        const T& operator[](std::size_t i) const { return data_[i]; }
+
+        T* begin() { return data_; }
+        T* end() { return data_ + size_; }
+        const T* begin() const { return data_; }
+        const T* end() const { return data_ + size_; }
+
+    private:
+        void release() {
+            if (owned_ && data_) {
+                ::operator delete(data_, std::align_val_t{ alignment });
+            }
+            data_ = nullptr;
+            size_ = 0;
+            owned_ = false;
+        }
+
+        T* data_ = nullptr;
+        std::size_t size_{ 0 };
+        bool owned_ = false;
+    };
+}
+
+namespace Prog1 {
+    // one 64-byte aligned block of raw memory. Big blocks are mapped from the OS with transparent
+    // huge pages requested, so they can also grow without copying (mremap); small ones use operator new
+    class Arena {
+    public:
+        static constexpr std::size_t alignment = 64;
+        // blocks from this size on are mapped and get MADV_HUGEPAGE
+        static constexpr std::size_t map_threshold = std::size_t{ 4 } << 20;
+
+        Arena() = default;
+        explicit Arena(std::size_t bytes);
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        Arena(Arena&& other) noexcept;
+        Arena& operator=(Arena&& other) noexcept;
+        ~Arena();
+
+        // makes the block at least `bytes` long keeping its contents; the block may move
+        void grow(std::size_t bytes);
+
+        char* data() const { return data_; }
+        std::size_t capacity() const { return capacity_; }
+
+    private:
+        void release();
+
+        char* data_ = nullptr;
+        std::size_t capacity_{ 0 };
+        bool mapped_ = false;
+    };
+
+    inline std::size_t align_up(std::size_t n, std::size_t a = Arena::alignment) {
+        return (n + a - 1) / a * a;
+    }
+}
+
+#endif //OOPPROG1_PROG1BUFFER_H
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include "Prog1delta.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+
+namespace Prog1 {
+    template<class V, class I>
+    DeltaCSR<V, I>::DeltaCSR(BasicCSR<V, I> base, std::size_t max_delta)
+        : base_(std::move(base)),
+          max_delta_(max_delta ? max_delta : std::max<std::size_t>(1024, static_cast<std::size_t>(base_.msize) / 16)) {}
+
+    template<class V, class I>
+    void DeltaCSR<V, I>::set(I row, I col, V value) {
+        record(row, col, value, false);
+    }
+
+    template<class V, class I>
+    void DeltaCSR<V, I>::remove(I row, I col) {
+        record(row, col, V{ 0 }, true);
+    }
+
+    template<class V, class I>
+    void DeltaCSR<V, I>::record(I row, I col, V value, bool erased) {
+        if (row < 0 || row >= base_.row || col < 0 || col >= base_.col) {
+            throw std::runtime_error("Element coordinates out of range");
+        }
+        // O(1): the log is put in order only when it is read
+        delta_.push_back(Edit{ row, col, value, erased });
+        if (delta_.size() > max_delta_) {
+            compact();
+        }
+    }
+
+    template<class V, class I>
+    void DeltaCSR<V, I>::settle() const {
+        if (sorted_ == delta_.size()) {
+            return;
+        }
+        auto by_element = [](const Edit& x, const Edit& y) {
+            return std::tie(x.row, x.col) < std::tie(y.row, y.col);
+        };
+        // both steps are stable, so the edits of one element stay in the order they were made
+        std::stable_sort(delta_.begin() + sorted_, delta_.end(), by_element);
+        std::inplace_merge(delta_.begin(), delta_.begin() + sorted_, delta_.end(), by_element);
+        std::size_t n{ 0 };
+        for (std::size_t k = 0; k < delta_.size(); k++) {
+            if (k + 1 < delta_.size() && !by_element(delta_[k], delta_[k + 1])) {
+                continue; // overwritten by the next edit
+            }
+            delta_[n++] = delta_[k];
+        }
+        delta_.resize(n);
+        sorted_ = n;
+    }
+
+    template<class V, class I>
+    V DeltaCSR<V, I>::get_value(I row, I col) const {
+        settle();
+        auto it = std::lower_bound(delta_.begin(), delta_.end(), std::make_pair(row, col),
+                                   [](const Edit& e, const std::pair<I, I>& key) {
+                                       return std::make_pair(e.row, e.col) < key;
+                                   });
+        if (it != delta_.end() && it->row == row && it->col == col) {
+            return it->erased ? V{ 0 } : it->value;
+        }
+        return Prog1::get_value(base_, row, col);
+    }
+
+    template<class V, class I>
+    void DeltaCSR<V, I>::compact() {
+        if (delta_.empty()) {
+            return;
+        }
+        settle();
+        const BasicCSR<V, I>& a = base_;
+        // merge of a base row with its edits (both sorted by column); emit(col, value) gets the survivors
+        auto merge_row = [&](I i, std::size_t d, std::size_t d_end, auto&& emit) {
+            I k = a.arr_row[i], k_end = a.arr_row[i + 1];
+            while (k < k_end || d < d_end) {
+                if (d == d_end || (k < k_end && a.arr_col[k] < delta_[d].col)) {
+                    emit(a.arr_col[k], a.arr_val[k]);
+                    k++;
+                    continue;
+                }
+                if (k < k_end && a.arr_col[k] == delta_[d].col) {
+                    k++; // replaced or erased by the edit
+                }
+                if (!delta_[d].erased) {
+                    emit(delta_[d].col, delta_[d].value);
+                }
+                d++;
+            }
+        };
+        auto first_edit = [&](I row) {
+            return static_cast<std::size_t>(std::lower_bound(delta_.begin(), delta_.end(), row,
+                [](const Edit& e, I r) { return e.row < r; }) - delta_.begin());
+        };
+
+        int parts = static_cast<std::size_t>(a.msize) + delta_.size() < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_rows(a, parts);
+        BasicCSR<V, I> result;
+        result.allocate(a.row, 0);
+        result.col = a.col;
+        I* new_row = result.arr_row.data();
+        std::vector<I> part_size(parts + 1, 0);
+
+        // 1st pass: new row lengths (rows without edits keep theirs)
+        parallel_for(parts, [&](int p) {
+            std::size_t d = first_edit(bounds[p]);
+            I total{ 0 };
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                std::size_t d_end = d;
+                while (d_end < delta_.size() && delta_[d_end].row == i) {
+                    d_end++;
+                }
+                I count = a.arr_row[i + 1] - a.arr_row[i];
+                if (d != d_end) {
+                    count = 0;
+                    merge_row(i, d, d_end, [&](I, V) { count++; });
+                }
+                new_row[i + 1] = count;
+                total += count;
+                d = d_end;
+            }
+            part_size[p + 1] = total;
+        });
+        for (int p = 0; p < parts; p++) {
+            part_size[p + 1] += part_size[p];
+        }
+        result.resize_nnz(part_size[parts]); // may move the arena
+        new_row = result.arr_row.data();
+        I* new_col = result.arr_col.data();
+        V* new_val = result.arr_val.data();
+
+        // 2nd pass: copy untouched rows, merge the edited ones
+        new_row[0] = 0;
+        parallel_for(parts, [&](int p) {
+            std::size_t d = first_edit(bounds[p]);
+            I pos = part_size[p];
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                std::size_t d_end = d;
+                while (d_end < delta_.size() && delta_[d_end].row == i) {
+                    d_end++;
+                }
+                if (d == d_end) {
+                    I from = a.arr_row[i], count = a.arr_row[i + 1] - from;
+                    std::copy_n(a.arr_col.data() + from, count, new_col + pos);
+                    std::copy_n(a.arr_val.data() + from, count, new_val + pos);
+                    pos += count;
+                } else {
+                    merge_row(i, d, d_end, [&](I j, V v) {
+                        new_col[pos] = j;
+                        new_val[pos] = v;
+                        pos++;
+                    });
+                }
+                new_row[i + 1] = pos;
+                d = d_end;
+            }
+        });
+
+        base_ = std::move(result);
+        delta_.clear();
+        sorted_ = 0;
+    }
+
+    template<class V, class I>
+    const BasicCSR<V, I>& DeltaCSR<V, I>::csr() {
+        compact();
+        return base_;
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template class DeltaCSR<V, I>;
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
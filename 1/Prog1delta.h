@@ -0,0 +1,53 @@
+#ifndef OOPPROG1_PROG1DELTA_H
+#define OOPPROG1_PROG1DELTA_H
+
+#include <cstddef>
+#include <vector>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // CSR that takes single-element edits: they are appended to a log, which is sorted by (row, col) only
+    // when read, and merged into the arrays when it grows past max_delta (or on compact()). A later edit
+    // of the same element wins. Not for concurrent use: get_value() may reorder the log
+    template<class V, class I>
+    class DeltaCSR {
+    public:
+        // max_delta == 0 picks max(1024, nnz / 16)
+        explicit DeltaCSR(BasicCSR<V, I> base, std::size_t max_delta = 0);
+
+        // inserts the element or replaces its value
+        void set(I row, I col, V value);
+        // removes the element (nothing happens if there is none)
+        void remove(I row, I col);
+        // value with the pending edits applied
+        V get_value(I row, I col) const;
+
+        I rows() const { return base_.row; }
+        I cols() const { return base_.col; }
+        // edits in the log, repeats of one element counted until the next read
+        std::size_t pending() const { return delta_.size(); }
+
+        // merges the log into the arrays, O(nnz + pending)
+        void compact();
+        // up-to-date matrix (compacts first)
+        const BasicCSR<V, I>& csr();
+
+    private:
+        struct Edit {
+            I row, col;
+            V value;
+            bool erased;
+        };
+
+        void record(I row, I col, V value, bool erased);
+        // sorts the unsorted tail of the log into the rest, keeping the last edit of every element
+        void settle() const;
+
+        BasicCSR<V, I> base_;
+        mutable std::vector<Edit> delta_;
+        mutable std::size_t sorted_{ 0 }; // delta_[0 .. sorted_) is sorted by (row, col) without repeats
+        std::size_t max_delta_;
+    };
+}
+
+#endif //OOPPROG1_PROG1DELTA_H
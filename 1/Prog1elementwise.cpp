@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Prog1elementwise.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1simd.h"
+
+
+namespace Prog1 {
+    namespace {
+        // number of values in both sorted lists (no value repeats inside a list), from positions i and j on
+        template<class I>
+        std::size_t count_common_scalar(const I* a, std::size_t na, const I* b, std::size_t nb,
+                                        std::size_t i = 0, std::size_t j = 0) {
+            std::size_t count{ 0 };
+            while (i < na && j < nb) {
+                if (a[i] < b[j]) {
+                    i++;
+                } else if (b[j] < a[i]) {
+                    j++;
+                } else {
+                    count++;
+                    i++;
+                    j++;
+                }
+            }
+            return count;
+        }
+
+#ifdef PROG1_HAVE_AVX2_PATH
+        // 8 values of a against all 8 rotations of 8 values of b, then the block with the smaller last value
+        // moves on (both on a tie). Every pair of blocks meets at most once, so no match is counted twice.
+        // Equality only, so signed and unsigned indices are the same
+        template<class I>
+        __attribute__((target("avx2")))
+        std::size_t count_common_avx2(const I* a, std::size_t na, const I* b, std::size_t nb) {
+            static_assert(sizeof(I) == 4, "8 lanes of 32-bit indices");
+            const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+            std::size_t i = 0, j = 0, count = 0;
+            while (i + 8 <= na && j + 8 <= nb) {
+                __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+                __m256i hit = _mm256_cmpeq_epi32(va, vb);
+                for (int r = 1; r < 8; r++) {
+                    vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(va, vb));
+                }
+                count += std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(hit))));
+                I a_last = a[i + 7], b_last = b[j + 7];
+                i += a_last <= b_last ? 8 : 0;
+                j += b_last <= a_last ? 8 : 0;
+            }
+            return count + count_common_scalar(a, na, b, nb, i, j);
+        }
+#endif
+
+        template<class I>
+        std::size_t count_common(const I* a, std::size_t na, const I* b, std::size_t nb) {
+#ifdef PROG1_HAVE_AVX2_PATH
+            if constexpr (sizeof(I) == 4) {
+                if (cpu_has_avx2()) {
+                    return count_common_avx2(a, na, b, nb);
+                }
+            }
+#endif
+            return count_common_scalar(a, na, b, nb);
+        }
+
+        // value of the result from the two values, 0 standing for a missing one
+        template<ElementOp op, class V>
+        V combine(V x, V y) {
+            if constexpr (op == ElementOp::add) {
+                return x + y;
+            } else if constexpr (op == ElementOp::subtract) {
+                return x - y;
+            } else if constexpr (op == ElementOp::multiply) {
+                return x * y;
+            } else if constexpr (op == ElementOp::min) {
+                return y < x ? y : x;
+            } else {
+                return x < y ? y : x;
+            }
+        }
+
+        // merges row i of a and b into col / val, returns the number of elements written
+        template<ElementOp op, class V, class I>
+        I merge_row(const BasicCSR<V, I>& a, const BasicCSR<V, I>& b, I i, I* col, V* val) {
+            I ka = a.arr_row[i], ea = a.arr_row[i + 1];
+            I kb = b.arr_row[i], eb = b.arr_row[i + 1];
+            I n{ 0 };
+            while (ka < ea && kb < eb) {
+                I ja = a.arr_col[ka], jb = b.arr_col[kb];
+                if (ja == jb) {
+                    col[n] = ja;
+                    val[n++] = combine<op>(a.arr_val[ka++], b.arr_val[kb++]);
+                } else if constexpr (op == ElementOp::multiply) {
+                    if (ja < jb) {
+                        ka++;
+                    } else {
+                        kb++;
+                    }
+                } else if (ja < jb) {
+                    col[n] = ja;
+                    val[n++] = combine<op>(a.arr_val[ka++], V{ 0 });
+                } else {
+                    col[n] = jb;
+                    val[n++] = combine<op>(V{ 0 }, b.arr_val[kb++]);
+                }
+            }
+            if constexpr (op != ElementOp::multiply) {
+                for (; ka < ea; ka++) {
+                    col[n] = a.arr_col[ka];
+                    val[n++] = combine<op>(a.arr_val[ka], V{ 0 });
+                }
+                for (; kb < eb; kb++) {
+                    col[n] = b.arr_col[kb];
+                    val[n++] = combine<op>(V{ 0 }, b.arr_val[kb]);
+                }
+            }
+            return n;
+        }
+
+        template<ElementOp op, class V, class I>
+        BasicCSR<V, I> merge(const BasicCSR<V, I>& a, const BasicCSR<V, I>& b) {
+            if (a.row != b.row || a.col != b.col) {
+                throw std::runtime_error("Element-wise operation on matrices of different sizes");
+            }
+            const std::size_t rows = a.row;
+            if (rows == 0) {
+                // a default or erased matrix has no offsets to read
+                BasicCSR<V, I> result;
+                result.allocate(0, 0);
+                result.arr_row[0] = 0;
+                result.col = a.col;
+                return result;
+            }
+            // rows are shared out by the elements of both matrices
+            std::vector<std::uint64_t> work(rows + 1);
+            for (std::size_t i = 0; i <= rows; i++) {
+                work[i] = static_cast<std::uint64_t>(a.arr_row[i]) + static_cast<std::uint64_t>(b.arr_row[i]);
+            }
+            int parts = work[rows] < parallel_min_nnz ? 1 : thread_count();
+            std::vector<std::uint64_t> bounds = partition_offsets<std::uint64_t>(work.data(), rows, parts);
+            std::vector<I> part_size(parts + 1, 0);
+            BasicCSR<V, I> result;
+            result.allocate(a.row, 0);
+            result.col = a.col;
+            I* new_row = result.arr_row.data();
+
+            // symbolic pass: |A_i| + |B_i| - common for a union, common for an intersection
+            parallel_for(parts, [&](int p) {
+                I total{ 0 };
+                for (std::size_t i = bounds[p]; i < bounds[p + 1]; i++) {
+                    const I* ca = a.arr_col.data() + a.arr_row[i];
+                    const I* cb = b.arr_col.data() + b.arr_row[i];
+                    std::size_t na = a.arr_row[i + 1] - a.arr_row[i], nb = b.arr_row[i + 1] - b.arr_row[i];
+                    std::size_t common = count_common(ca, na, cb, nb);
+                    new_row[i + 1] = static_cast<I>(op == ElementOp::multiply ? common : na + nb - common);
+                    total += new_row[i + 1];
+                }
+                part_size[p + 1] = total;
+            });
+            for (int p = 0; p < parts; p++) {
+                part_size[p + 1] += part_size[p];
+            }
+            result.resize_nnz(part_size[parts]); // may move the arena
+            new_row = result.arr_row.data();
+
+            // numeric pass straight into the result
+            new_row[0] = 0;
+            parallel_for(parts, [&](int p) {
+                I pos = part_size[p];
+                for (std::size_t i = bounds[p]; i < bounds[p + 1]; i++) {
+                    pos += merge_row<op>(a, b, static_cast<I>(i), result.arr_col.data() + pos, result.arr_val.data() + pos);
+                    new_row[i + 1] = pos;
+                }
+            });
+            return result;
+        }
+    }
+
+
+
+    template<class V, class I>
+    BasicCSR<V, I> elementwise(const BasicCSR<V, I>& a, const BasicCSR<V, I>& b, ElementOp op) {
+        switch (op) {
+        case ElementOp::add:
+            return merge<ElementOp::add>(a, b);
+        case ElementOp::subtract:
+            return merge<ElementOp::subtract>(a, b);
+        case ElementOp::multiply:
+            return merge<ElementOp::multiply>(a, b);
+        case ElementOp::min:
+            return merge<ElementOp::min>(a, b);
+        default:
+            return merge<ElementOp::max>(a, b);
+        }
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template BasicCSR<V, I> elementwise<V, I>(const BasicCSR<V, I>&, const BasicCSR<V, I>&, ElementOp);
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
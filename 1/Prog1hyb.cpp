@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <bit>
+#include <vector>
+#include "Prog1hyb.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+
+namespace Prog1 {
+    namespace {
+        // four sums side by side, so that the adds do not wait for each other
+        template<class V>
+        V dense_dot(const V* val, const V* x, std::size_t n) {
+            V s0{ 0 }, s1{ 0 }, s2{ 0 }, s3{ 0 };
+            std::size_t j = 0;
+            for (; j + 4 <= n; j += 4) {
+                s0 += val[j] * x[j];
+                s1 += val[j + 1] * x[j + 1];
+                s2 += val[j + 2] * x[j + 2];
+                s3 += val[j + 3] * x[j + 3];
+            }
+            for (; j < n; j++) {
+                s0 += val[j] * x[j];
+            }
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        // stored elements of dense row d
+        template<class V, class I>
+        I dense_nnz(const HybridCSR<V, I>& hyb, I d) {
+            const std::uint64_t* mask = hyb.dense_mask.data() + d * hyb.mask_words();
+            I count{ 0 };
+            for (std::size_t w = 0; w < hyb.mask_words(); w++) {
+                count += static_cast<I>(std::popcount(mask[w]));
+            }
+            return count;
+        }
+    }
+
+
+
+    template<class V, class I>
+    std::int64_t HybridCSR<V, I>::dense_index(I i) const {
+        const I* it = std::lower_bound(dense_rows.begin(), dense_rows.end(), i);
+        return it != dense_rows.end() && *it == i ? it - dense_rows.begin() : -1;
+    }
+
+    template<class V, class I>
+    HybridCSR<V, I> build_hybrid(const BasicCSR<V, I>& coord, double min_density) {
+        HybridCSR<V, I> hyb;
+        hyb.row = coord.row;
+        hyb.col = coord.col;
+        hyb.msize = coord.msize;
+
+        std::vector<I> dense;
+        I dense_elements{ 0 };
+        for (I i = 0; i < coord.row; i++) {
+            I len = coord.arr_row[i + 1] - coord.arr_row[i];
+            if (len > 0 && static_cast<double>(len) >= min_density * static_cast<double>(coord.col)) {
+                dense.push_back(i);
+                dense_elements += len;
+            }
+        }
+        hyb.dense_rows = AlignedBuffer<I>(dense.size());
+        std::copy(dense.begin(), dense.end(), hyb.dense_rows.begin());
+
+        // sparse part: the same rows with the dense ones emptied
+        BasicCSR<V, I>& sparse = hyb.sparse;
+        sparse.allocate(coord.row, coord.msize - dense_elements);
+        sparse.col = coord.col;
+        I* new_row = sparse.arr_row.data();
+        new_row[0] = 0;
+        std::size_t next_dense = 0;
+        for (I i = 0; i < coord.row; i++) {
+            bool is_dense = next_dense < dense.size() && dense[next_dense] == i;
+            next_dense += is_dense;
+            new_row[i + 1] = new_row[i] + (is_dense ? 0 : coord.arr_row[i + 1] - coord.arr_row[i]);
+        }
+        int parts = static_cast<std::size_t>(sparse.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_offsets(new_row, coord.row, parts);
+        parallel_for(parts, [&](int p) {
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                I count = new_row[i + 1] - new_row[i];
+                std::copy_n(coord.arr_col.data() + coord.arr_row[i], count, sparse.arr_col.data() + new_row[i]);
+                std::copy_n(coord.arr_val.data() + coord.arr_row[i], count, sparse.arr_val.data() + new_row[i]);
+            }
+        });
+
+        // dense part
+        const std::size_t cols = coord.col, words = hyb.mask_words();
+        hyb.dense_val = AlignedBuffer<V>(dense.size() * cols, true);
+        hyb.dense_mask = AlignedBuffer<std::uint64_t>(dense.size() * words, true);
+        int dense_parts = static_cast<int>(std::min<std::size_t>(dense.size(), thread_count()));
+        parallel_for(dense_parts, [&](int p) {
+            for (std::size_t d = p; d < dense.size(); d += dense_parts) {
+                V* val = hyb.dense_val.data() + d * cols;
+                std::uint64_t* mask = hyb.dense_mask.data() + d * words;
+                for (I k = coord.arr_row[dense[d]]; k < coord.arr_row[dense[d] + 1]; k++) {
+                    I j = coord.arr_col[k];
+                    val[j] = coord.arr_val[k];
+                    mask[j / 64] |= std::uint64_t{ 1 } << (j % 64);
+                }
+            }
+        });
+        return hyb;
+    }
+
+    template<class V, class I>
+    BasicCSR<V, I> to_csr(const HybridCSR<V, I>& hyb) {
+        BasicCSR<V, I> coord;
+        coord.allocate(hyb.row, hyb.msize);
+        coord.col = hyb.col;
+        I* new_row = coord.arr_row.data();
+        new_row[0] = 0;
+        I d{ 0 };
+        for (I i = 0; i < hyb.row; i++) {
+            bool is_dense = d < hyb.dense_count() && hyb.dense_rows[d] == i;
+            new_row[i + 1] = new_row[i] + (is_dense ? dense_nnz(hyb, d++) : hyb.sparse.arr_row[i + 1] - hyb.sparse.arr_row[i]);
+        }
+
+        int parts = static_cast<std::size_t>(hyb.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_offsets(new_row, hyb.row, parts);
+        parallel_for(parts, [&](int p) {
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                I pos = new_row[i];
+                std::int64_t dense = hyb.dense_index(i);
+                if (dense < 0) {
+                    I from = hyb.sparse.arr_row[i], count = hyb.sparse.arr_row[i + 1] - from;
+                    std::copy_n(hyb.sparse.arr_col.data() + from, count, coord.arr_col.data() + pos);
+                    std::copy_n(hyb.sparse.arr_val.data() + from, count, coord.arr_val.data() + pos);
+                    continue;
+                }
+                const V* val = hyb.dense_val.data() + dense * hyb.col;
+                const std::uint64_t* mask = hyb.dense_mask.data() + dense * hyb.mask_words();
+                for (std::size_t w = 0; w < hyb.mask_words(); w++) {
+                    for (std::uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+                        I j = static_cast<I>(w * 64 + std::countr_zero(bits));
+                        coord.arr_col[pos] = j;
+                        coord.arr_val[pos] = val[j];
+                        pos++;
+                    }
+                }
+            }
+        });
+        return coord;
+    }
+
+    template<class V, class I>
+    V get_value(const HybridCSR<V, I>& hyb, std::type_identity_t<I> row, std::type_identity_t<I> col) {
+        std::int64_t d = hyb.dense_index(row);
+        if (d < 0) {
+            return get_value(hyb.sparse, row, col);
+        }
+        // unstored elements hold 0 as well
+        return hyb.dense_val[d * hyb.col + col];
+    }
+
+    template<class V, class I>
+    void specialfunc(HybridCSR<V, I>& hyb) {
+        specialfunc(hyb.sparse);
+        const std::size_t cols = hyb.col, words = hyb.mask_words();
+        std::vector<I> kept(hyb.dense_count());
+        int parts = static_cast<int>(std::min<std::size_t>(hyb.dense_count(), thread_count()));
+        parallel_for(parts, [&](int p) {
+            for (std::size_t d = p; d < static_cast<std::size_t>(hyb.dense_count()); d += parts) {
+                V* val = hyb.dense_val.data() + d * cols;
+                std::uint64_t* mask = hyb.dense_mask.data() + d * words;
+                // first minimum of the stored elements
+                std::size_t from = cols;
+                for (std::size_t w = 0; w < words; w++) {
+                    for (std::uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+                        std::size_t j = w * 64 + std::countr_zero(bits);
+                        if (from == cols || val[j] < val[from]) {
+                            from = j;
+                        }
+                    }
+                }
+                // drop everything to the left of it
+                std::fill_n(val, from == cols ? 0 : from, V{ 0 });
+                for (std::size_t w = 0; w < words && w * 64 < from; w++) {
+                    std::size_t end = from - w * 64;
+                    mask[w] &= end >= 64 ? 0 : ~std::uint64_t{ 0 } << end;
+                }
+                kept[d] = dense_nnz(hyb, static_cast<I>(d));
+            }
+        });
+        hyb.msize = hyb.sparse.msize;
+        for (I k : kept) {
+            hyb.msize += k;
+        }
+    }
+
+    template<class V, class I>
+    void spmv(const HybridCSR<V, I>& hyb, const V* x, V* y) {
+        spmv(hyb.sparse, x, y); // gives 0 for the dense rows
+        const std::size_t count = hyb.dense_count(), cols = hyb.col;
+        if (count == 0 || cols == 0) {
+            return;
+        }
+        // the dense rows one after another as count * cols cells, cut into equal ranges
+        const std::size_t cells = count * cols;
+        int parts = cells < parallel_min_nnz ? 1 : thread_count();
+        std::vector<V> partial(static_cast<std::size_t>(parts) * count, V{ 0 });
+        parallel_for(parts, [&](int p) {
+            std::size_t begin = cells * p / parts, end = cells * (p + 1) / parts;
+            while (begin < end) {
+                std::size_t d = begin / cols, j = begin % cols;
+                std::size_t stop = std::min(end, (d + 1) * cols);
+                partial[p * count + d] += dense_dot(hyb.dense_val.data() + begin, x + j, stop - begin);
+                begin = stop;
+            }
+        });
+        for (std::size_t d = 0; d < count; d++) {
+            V sum{ 0 };
+            for (int p = 0; p < parts; p++) {
+                sum += partial[p * count + d];
+            }
+            y[hyb.dense_rows[d]] = sum;
+        }
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template struct HybridCSR<V, I>; \
+    template HybridCSR<V, I> build_hybrid<V, I>(const BasicCSR<V, I>&, double); \
+    template BasicCSR<V, I> to_csr<V, I>(const HybridCSR<V, I>&); \
+    template V get_value<V, I>(const HybridCSR<V, I>&, I, I); \
+    template void specialfunc<V, I>(HybridCSR<V, I>&); \
+    template void spmv<V, I>(const HybridCSR<V, I>&, const V*, V*);
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
@@ -0,0 +1,48 @@
+#ifndef OOPPROG1_PROG1HYB_H
+#define OOPPROG1_PROG1HYB_H
+
+#include <cstdint>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // CSR for matrices with a few nearly full rows among many sparse ones: those rows are kept as dense
+    // value arrays (no column indices) plus a bit per column telling which elements are stored, the others
+    // stay in an ordinary CSR. Unstored elements of a dense row hold 0
+    template<class V, class I>
+    struct HybridCSR {
+        I row{ 0 }, col{ 0 }, msize{ 0 };    // msize - stored elements of both parts
+        BasicCSR<V, I> sparse;               // all rows, the dense ones empty
+        AlignedBuffer<I> dense_rows;         // rows kept dense, increasing
+        AlignedBuffer<V> dense_val;          // dense row d is dense_val[d * col .. (d + 1) * col)
+        AlignedBuffer<std::uint64_t> dense_mask; // bit j of dense row d is word d * mask_words() + j / 64
+
+        I dense_count() const { return static_cast<I>(dense_rows.size()); }
+        std::size_t mask_words() const { return (static_cast<std::size_t>(col) + 63) / 64; }
+        // index in dense_rows of row i, -1 if it is sparse
+        std::int64_t dense_index(I i) const;
+    };
+
+    // rows with at least min_density * col elements become dense. A dense row costs sizeof(V) + 1/8 bytes
+    // per column against sizeof(I) + sizeof(V) per element, so the default pays off for every type pair
+    template<class V, class I>
+    HybridCSR<V, I> build_hybrid(const BasicCSR<V, I>& coord, double min_density = 0.75);
+
+    // back to one CSR
+    template<class V, class I>
+    BasicCSR<V, I> to_csr(const HybridCSR<V, I>& hyb);
+
+    template<class V, class I>
+    V get_value(const HybridCSR<V, I>& hyb, std::type_identity_t<I> row, std::type_identity_t<I> col);
+
+    // specialfunc() of both parts; dense rows stay dense however many elements they lose
+    template<class V, class I>
+    void specialfunc(HybridCSR<V, I>& hyb);
+
+    // y = A * x. The dense rows are cut into column ranges shared out between the threads, so a few long
+    // rows do not hold up the rest. Their unstored elements multiply x too (this differs from CSR only
+    // for infinite or NaN x)
+    template<class V, class I>
+    void spmv(const HybridCSR<V, I>& hyb, const V* x, V* y);
+}
+
+#endif //OOPPROG1_PROG1HYB_H
@@ -0,0 +1,1059 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Prog1io.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1stats.h"
+
+namespace Prog1 {
+    MappedFile::MappedFile(const std::string& path, bool sequential) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + strerror(errno));
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path + ": " + strerror(err));
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                int err = errno;
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + path + ": " + strerror(err));
+            }
+            ::madvise(p, size_, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+            data_ = static_cast<const char*>(p);
+        }
+        ::close(fd);
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            if (data_) {
+                ::munmap(const_cast<char*>(data_), size_);
+            }
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    void MappedFile::release(std::size_t offset) {
+        std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        std::size_t length = std::min(offset, size_) / page * page;
+        if (length > 0) {
+            ::madvise(const_cast<char*>(data_), length, MADV_DONTNEED);
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+
+
+    NumberReader::NumberReader(std::string text, std::string name) : text_(std::move(text)), name_(std::move(name)) {}
+
+    NumberReader NumberReader::from_stdin() {
+        std::string text;
+        std::size_t size{ 0 };
+        // appends the next chunk, false at the end of the input
+        auto read_some = [&] {
+            while (true) {
+                text.resize(std::max<std::size_t>(size + (std::size_t{ 1 } << 20), text.size()));
+                ssize_t n = ::read(STDIN_FILENO, text.data() + size, text.size() - size);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    throw std::runtime_error(std::string("Cannot read the standard input: ") + strerror(errno));
+                }
+                size += static_cast<std::size_t>(n);
+                return n > 0;
+            }
+        };
+        // the wait for the first bytes is the writer's time (or the user's), the timer starts after it
+        if (read_some()) {
+            PROG1_STATS_TIMER(parse);
+            while (read_some()) {
+            }
+        }
+        text.resize(size);
+        return NumberReader(std::move(text), "stdin");
+    }
+
+    NumberReader NumberReader::from_file(const std::string& path) {
+        PROG1_STATS_TIMER(parse);
+        MappedFile file(path);
+        return NumberReader(std::string(file.data(), file.size()), path);
+    }
+
+    void NumberReader::fail(std::size_t at, const std::string& what) const {
+        throw std::runtime_error(name_ + ", line " + std::to_string(line_) + ", column "
+                                 + std::to_string(at - line_start_ + 1) + ": " + what);
+    }
+
+    void NumberReader::skip_space() {
+        const std::size_t size = text_.size();
+        while (pos_ < size) {
+            char c = text_[pos_];
+            if (c == '\n') {
+                line_++;
+                line_start_ = pos_ + 1;
+            } else if (c != ' ' && c != '\t' && c != '\r') {
+                break;
+            }
+            pos_++;
+        }
+    }
+
+    void NumberReader::expect_end() {
+        skip_space();
+        if (pos_ != text_.size()) {
+            fail(pos_, "unexpected data after the last number");
+        }
+    }
+
+    void NumberReader::expect_room(std::uint64_t count, std::size_t shortest) {
+        skip_space();
+        if (count > (text_.size() - pos_ + 1) / shortest) {
+            fail(pos_, "more elements announced than the input holds");
+        }
+    }
+
+    template<class T>
+    T NumberReader::next() {
+        skip_space();
+        const char* begin = text_.data() + pos_;
+        const char* end = text_.data() + text_.size();
+        if (begin == end) {
+            fail(pos_, "number expected, end of input found");
+        }
+        T value{};
+        auto [ptr, ec] = std::from_chars(begin, end, value);
+        if (ec == std::errc::result_out_of_range) {
+            fail(pos_, "number out of range");
+        }
+        // the number must end at a blank, "12x" is not 12
+        if (ec != std::errc() || (ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')) {
+            fail(pos_, std::is_floating_point_v<T> ? "number expected" : "integer expected");
+        }
+        pos_ += static_cast<std::size_t>(ptr - begin);
+        return value;
+    }
+
+    template<class T>
+    T NumberReader::next(T min, T max) {
+        std::size_t at = (skip_space(), pos_);
+        T value = next<T>();
+        if (value < min || value > max) {
+            fail(at, "number out of the allowed range");
+        }
+        return value;
+    }
+
+    template<class V, class I>
+    BasicCSR<V, I> read_csr_text(NumberReader& in) {
+        PROG1_STATS_TIMER(parse);
+        const I index_max = std::numeric_limits<I>::max();
+        I rows = in.next<I>(0, index_max - 1);
+        I cols = in.next<I>(0, index_max);
+        I nnz = in.next<I>(0, index_max);
+        if (nnz > 0 && (rows == 0 || cols == 0)) {
+            throw std::runtime_error("Elements given for an empty matrix");
+        }
+        // "col row value" and a blank for every element
+        in.expect_room(static_cast<std::uint64_t>(nnz), 6);
+        std::vector<I> row_idx(nnz), col_idx(nnz);
+        std::vector<V> vals(nnz);
+        for (I k = 0; k < nnz; k++) {
+            col_idx[k] = in.next<I>(0, cols - 1);
+            row_idx[k] = in.next<I>(0, rows - 1);
+            vals[k] = in.next<V>();
+        }
+        in.expect_end();
+        return build_csr_from_coo<V, I>(rows, cols, row_idx.data(), col_idx.data(), vals.data(), nnz);
+    }
+
+
+
+    namespace {
+        // cursor over the text; keeps the line number for error messages
+        struct Scanner {
+            const char* p;
+            const char* end;
+            long long line{ 1 };
+
+            [[noreturn]] void fail(const std::string& what) const {
+                throw std::runtime_error("Matrix Market, line " + std::to_string(line) + ": " + what);
+            }
+
+            void skip_blanks() {
+                while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+                    p++;
+                }
+            }
+
+            void skip_line() {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                p = nl ? nl + 1 : end;
+                line++;
+            }
+
+            // skips whitespace including line breaks
+            void skip_space() {
+                while (p < end) {
+                    if (*p == '\n') {
+                        line++;
+                    } else if (*p != ' ' && *p != '\t' && *p != '\r') {
+                        break;
+                    }
+                    p++;
+                }
+            }
+
+            std::string word() {
+                skip_blanks();
+                const char* b = p;
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+                    p++;
+                }
+                std::string w(b, p);
+                for (char& c : w) {
+                    if (c >= 'A' && c <= 'Z') {
+                        c = static_cast<char>(c - 'A' + 'a');
+                    }
+                }
+                return w;
+            }
+
+            // the next number on the current line; it must end at a blank or the end of the line, "12x" is not 12
+            template<class T>
+            T number() {
+                skip_blanks();
+                T value{};
+                auto [ptr, ec] = std::from_chars(p, end, value);
+                if (ec == std::errc::result_out_of_range) {
+                    fail("number out of range");
+                }
+                if (ec != std::errc() || (ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\r' && *ptr != '\n')) {
+                    fail("number expected");
+                }
+                p = ptr;
+                return value;
+            }
+
+            // nothing but blanks up to the end of the line, then moves past it
+            void end_line() {
+                skip_blanks();
+                if (p < end && *p != '\n') {
+                    fail("end of line expected");
+                }
+                if (p < end) {
+                    p++;
+                    line++;
+                }
+            }
+        };
+    }
+
+
+
+    namespace {
+        struct MtxHeader {
+            std::uint64_t rows, cols, entries;
+            bool pattern;
+            bool mirror; // symmetric or skew-symmetric: every off-diagonal element stands for two
+            bool skew;
+        };
+
+        // banner, comments and the size line
+        template<class V, class I>
+        MtxHeader read_mtx_header(Scanner& in) {
+            if (in.word() != "%%matrixmarket" || in.word() != "matrix") {
+                in.fail("not a Matrix Market file");
+            }
+            if (in.word() != "coordinate") {
+                in.fail("only the coordinate format is supported");
+            }
+            std::string field = in.word();
+            bool real_ok = std::is_floating_point_v<V>;
+            if (field != "integer" && field != "pattern" && !(field == "real" && real_ok)) {
+                in.fail("unsupported field '" + field + (real_ok ? "' (integer, real or pattern expected)"
+                                                                 : "' (integer or pattern expected)"));
+            }
+            std::string symmetry = in.word();
+            if (symmetry != "general" && symmetry != "symmetric" && symmetry != "skew-symmetric") {
+                in.fail("unsupported symmetry '" + symmetry + "'");
+            }
+            in.skip_line();
+
+            // comments and blank lines before the size line
+            while (true) {
+                in.skip_blanks();
+                if (in.p < in.end && (*in.p == '%' || *in.p == '\n')) {
+                    in.skip_line();
+                } else {
+                    break;
+                }
+            }
+
+            MtxHeader h{};
+            const std::uint64_t index_max = static_cast<std::uint64_t>(std::numeric_limits<I>::max());
+            h.rows = in.number<std::uint64_t>();
+            h.cols = in.number<std::uint64_t>();
+            h.entries = in.number<std::uint64_t>();
+            in.end_line();
+            if (h.rows >= index_max || h.cols > index_max) {
+                in.fail("matrix size does not fit the index type");
+            }
+            if (symmetry != "general" && h.rows != h.cols) {
+                in.fail("symmetric matrix must be square");
+            }
+            h.pattern = field == "pattern";
+            h.mirror = symmetry != "general";
+            h.skew = symmetry == "skew-symmetric";
+            if (h.entries > index_max || (h.mirror && 2 * h.entries > index_max)) {
+                in.fail("too many elements");
+            }
+            // every element takes a line of "i j" (and a value) at least, so the count in the header is checked
+            // against the text before anything is allocated for it
+            const std::uint64_t shortest = h.pattern ? 4 : 6;
+            if (h.entries > (static_cast<std::uint64_t>(in.end - in.p) + 1) / shortest) {
+                in.fail("more elements announced than the file holds");
+            }
+            return h;
+        }
+
+        // one "i j [value]" line (after any blank lines) as 0-based coordinates
+        template<class V, class I>
+        void read_mtx_entry(Scanner& in, const MtxHeader& h, I& row, I& col, V& val) {
+            in.skip_space();
+            std::uint64_t i = in.number<std::uint64_t>();
+            std::uint64_t j = in.number<std::uint64_t>();
+            val = h.pattern ? V(1) : in.number<V>();
+            if (i < 1 || i > h.rows || j < 1 || j > h.cols) {
+                in.fail("element coordinates out of range");
+            }
+            in.end_line();
+            row = static_cast<I>(i - 1);
+            col = static_cast<I>(j - 1);
+        }
+
+        void expect_end(Scanner& in) {
+            in.skip_space();
+            if (in.p != in.end) {
+                in.fail("unexpected data after the last element");
+            }
+        }
+    }
+
+    template<class V, class I>
+    BasicCSR<V, I> parse_mtx(const char* begin, const char* end) {
+        PROG1_STATS_TIMER(parse);
+        Scanner in{ begin, end };
+        MtxHeader h = read_mtx_header<V, I>(in);
+        V sign = h.skew ? V(-1) : V(1);
+        std::size_t capacity = h.mirror ? 2 * h.entries : h.entries;
+
+        std::vector<I> row_idx(capacity), col_idx(capacity);
+        std::vector<V> vals(capacity);
+        I* r = row_idx.data();
+        I* c = col_idx.data();
+        V* v = vals.data();
+        I nnz{ 0 };
+        for (std::uint64_t k = 0; k < h.entries; k++) {
+            read_mtx_entry(in, h, r[nnz], c[nnz], v[nnz]);
+            nnz++;
+            if (h.mirror && r[nnz - 1] != c[nnz - 1]) {
+                r[nnz] = c[nnz - 1];
+                c[nnz] = r[nnz - 1];
+                v[nnz] = sign * v[nnz - 1];
+                nnz++;
+            }
+        }
+        expect_end(in);
+
+        return build_csr_from_coo<V, I>(static_cast<I>(h.rows), static_cast<I>(h.cols), r, c, v, nnz);
+    }
+
+    template<class V, class I>
+    BasicCSR<V, I> load_mtx(const std::string& path) {
+        PROG1_STATS_TIMER(parse);
+        MappedFile file(path);
+        return parse_mtx<V, I>(file.data(), file.data() + file.size());
+    }
+
+
+
+    namespace {
+        const char csr_magic[8] = { 'P', 'R', 'O', 'G', '1', 'C', 'S', 'R' };
+        // 2: index_kind and value_kind in the words that version 1 left reserved
+        const std::uint32_t csr_version = 2;
+        const std::uint32_t csr_endian = 0x01020304;
+
+        // sizes come from the file header, so they are not trusted to fit in 64 bits
+        std::uint64_t checked_add(std::uint64_t a, std::uint64_t b) {
+            std::uint64_t r;
+            if (__builtin_add_overflow(a, b, &r)) {
+                throw std::runtime_error("Binary CSR file too large");
+            }
+            return r;
+        }
+
+        std::uint64_t checked_mul(std::uint64_t a, std::uint64_t b) {
+            std::uint64_t r;
+            if (__builtin_mul_overflow(a, b, &r)) {
+                throw std::runtime_error("Binary CSR file too large");
+            }
+            return r;
+        }
+
+        std::uint64_t align64(std::uint64_t n) {
+            return checked_add(n, 63) & ~std::uint64_t{ 63 };
+        }
+
+        // word-wise multiply-rotate hash, much faster than a byte-wise one on big arrays
+        std::uint64_t hash_bytes(std::uint64_t h, const void* data, std::size_t n) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            const std::uint64_t k = 0x9E3779B97F4A7C15ull;
+            for (; n >= 8; n -= 8, p += 8) {
+                std::uint64_t w;
+                std::memcpy(&w, p, 8);
+                h = ((h ^ w) * k);
+                h ^= h >> 29;
+            }
+            std::uint64_t tail{ 0 };
+            std::memcpy(&tail, p, n);
+            h = ((h ^ tail ^ (std::uint64_t{ n } << 56)) * k);
+            return h ^ (h >> 32);
+        }
+
+        // layout of the arrays after the header
+        struct CSRFileLayout {
+            std::uint64_t row_off, col_off, val_off, total;
+        };
+
+        CSRFileLayout csr_layout(std::int64_t row, std::int64_t msize, std::size_t index_size, std::size_t value_size) {
+            CSRFileLayout l{};
+            l.row_off = sizeof(CSRFileHeader);
+            l.col_off = align64(checked_add(l.row_off, checked_mul(static_cast<std::uint64_t>(row) + 1, index_size)));
+            l.val_off = align64(checked_add(l.col_off, checked_mul(static_cast<std::uint64_t>(msize), index_size)));
+            l.total = checked_add(l.val_off, checked_mul(static_cast<std::uint64_t>(msize), value_size));
+            return l;
+        }
+    }
+
+    namespace {
+        template<class T>
+        std::uint32_t number_kind() {
+            return std::is_floating_point_v<T> ? 2 : std::is_signed_v<T> ? 0 : 1;
+        }
+
+        // header without the checksum
+        template<class V, class I>
+        CSRFileHeader make_csr_header(I row, I col, I msize) {
+            CSRFileHeader hdr{};
+            std::memcpy(hdr.magic, csr_magic, sizeof(hdr.magic));
+            hdr.version = csr_version;
+            hdr.endian = csr_endian;
+            hdr.row = static_cast<std::int64_t>(row);
+            hdr.col = static_cast<std::int64_t>(col);
+            hdr.msize = static_cast<std::int64_t>(msize);
+            hdr.index_size = sizeof(I);
+            hdr.value_size = sizeof(V);
+            hdr.index_kind = number_kind<I>();
+            hdr.value_kind = number_kind<V>();
+            return hdr;
+        }
+    }
+
+    template<class V, class I>
+    std::uint64_t csr_checksum(const BasicCSR<V, I>& coord) {
+        std::uint64_t h = 0xCBF29CE484222325ull;
+        h = hash_bytes(h, coord.arr_row.data(), (static_cast<std::size_t>(coord.row) + 1) * sizeof(I));
+        h = hash_bytes(h, coord.arr_col.data(), static_cast<std::size_t>(coord.msize) * sizeof(I));
+        h = hash_bytes(h, coord.arr_val.data(), static_cast<std::size_t>(coord.msize) * sizeof(V));
+        return h;
+    }
+
+    template<class V, class I>
+    void save_csr(const BasicCSR<V, I>& coord, const std::string& path) {
+        CSRFileHeader hdr = make_csr_header<V, I>(coord.row, coord.col, coord.msize);
+        hdr.checksum = csr_checksum(coord);
+        CSRFileLayout l = csr_layout(hdr.row, hdr.msize, sizeof(I), sizeof(V));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        static const char zeros[64] = {};
+        auto pad_to = [&](std::uint64_t off) {
+            std::uint64_t pos = static_cast<std::uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(off - pos));
+        };
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        out.write(reinterpret_cast<const char*>(coord.arr_row.data()), (hdr.row + 1) * sizeof(I));
+        pad_to(l.col_off);
+        out.write(reinterpret_cast<const char*>(coord.arr_col.data()), hdr.msize * sizeof(I));
+        pad_to(l.val_off);
+        out.write(reinterpret_cast<const char*>(coord.arr_val.data()), hdr.msize * sizeof(V));
+        if (!out.flush()) {
+            throw std::runtime_error("Cannot write " + path);
+        }
+    }
+
+
+
+    namespace {
+        // header of a binary CSR file of file_size bytes starting at data (at least min(file_size, 64) bytes),
+        // checked against the V and I types and the file size
+        template<class V, class I>
+        CSRFileHeader read_csr_header(const char* data, std::uint64_t file_size, const std::string& path) {
+            const std::string bad = "Not a binary CSR file: " + path;
+            if (file_size < sizeof(CSRFileHeader)) {
+                throw std::runtime_error(bad);
+            }
+            CSRFileHeader hdr;
+            std::memcpy(&hdr, data, sizeof(hdr));
+            if (std::memcmp(hdr.magic, csr_magic, sizeof(csr_magic)) != 0) {
+                throw std::runtime_error(bad);
+            }
+            if (hdr.version != csr_version || hdr.endian != csr_endian) {
+                throw std::runtime_error("Unsupported binary CSR file version or byte order: " + path);
+            }
+            if (hdr.index_size != sizeof(I) || hdr.value_size != sizeof(V)
+                || hdr.index_kind != number_kind<I>() || hdr.value_kind != number_kind<V>()) {
+                throw std::runtime_error("Binary CSR file holds other value or index types: " + path);
+            }
+            const std::int64_t index_max = static_cast<std::int64_t>(
+                std::min<std::uint64_t>(std::numeric_limits<I>::max(), std::numeric_limits<std::int64_t>::max()));
+            if (hdr.row < 0 || hdr.col < 0 || hdr.msize < 0 || hdr.row >= index_max
+                || hdr.col > index_max || hdr.msize > index_max) {
+                throw std::runtime_error(bad);
+            }
+            if (file_size < csr_layout(hdr.row, hdr.msize, sizeof(I), sizeof(V)).total) {
+                throw std::runtime_error("Truncated binary CSR file: " + path);
+            }
+            return hdr;
+        }
+
+        // columns of the rows [first, last) in range and strictly increasing; the offsets are already checked
+        template<class V, class I>
+        bool columns_ok(const BasicCSR<V, I>& coord, I first, I last) {
+            for (I i = first; i < last; i++) {
+                I end = coord.arr_row[i + 1];
+                for (I k = coord.arr_row[i]; k < end; k++) {
+                    // a negative signed column turns into a huge unsigned one
+                    auto c = static_cast<std::make_unsigned_t<I>>(coord.arr_col[k]);
+                    if (c >= static_cast<std::make_unsigned_t<I>>(coord.col)
+                        || (k > coord.arr_row[i] && coord.arr_col[k] <= coord.arr_col[k - 1])) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // structure read from a file is checked before any kernel indexes with it: offsets from 0 to msize
+        // without going back, then the columns of every row
+        template<class V, class I>
+        bool structure_ok(const BasicCSR<V, I>& coord) {
+            if (coord.arr_row[0] != 0 || coord.arr_row[coord.row] != coord.msize) {
+                return false;
+            }
+            const std::size_t n = static_cast<std::size_t>(coord.row) + coord.msize;
+            int parts = n < parallel_min_nnz ? 1 : thread_count();
+            std::vector<char> ok(parts, 1);
+            parallel_for(parts, [&](int p) {
+                I first = static_cast<I>(static_cast<std::size_t>(coord.row) * p / parts);
+                I last = static_cast<I>(static_cast<std::size_t>(coord.row) * (p + 1) / parts);
+                for (I i = first; i < last; i++) {
+                    if (coord.arr_row[i + 1] < coord.arr_row[i]) {
+                        ok[p] = 0;
+                        return;
+                    }
+                }
+            });
+            if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+                return false;
+            }
+            std::vector<I> bounds = partition_rows(coord, parts);
+            parallel_for(parts, [&](int p) { ok[p] = columns_ok(coord, bounds[p], bounds[p + 1]); });
+            return std::find(ok.begin(), ok.end(), 0) == ok.end();
+        }
+    }
+
+
+
+    template<class V, class I>
+    CSRMapped<V, I>::CSRMapped(const std::string& path, bool verify) : file_(path, false) {
+        const std::string bad = "Not a binary CSR file: " + path;
+        CSRFileHeader hdr = read_csr_header<V, I>(file_.data(), file_.size(), path);
+        CSRFileLayout l = csr_layout(hdr.row, hdr.msize, sizeof(I), sizeof(V));
+
+        // the mapping is page aligned and the offsets are 64-byte aligned, so the arrays are usable in place
+        char* base = const_cast<char*>(file_.data());
+        csr_.row = static_cast<I>(hdr.row);
+        csr_.col = static_cast<I>(hdr.col);
+        csr_.msize = static_cast<I>(hdr.msize);
+        csr_.arr_row = AlignedBuffer<I>::borrow(reinterpret_cast<I*>(base + l.row_off), hdr.row + 1);
+        csr_.arr_col = AlignedBuffer<I>::borrow(reinterpret_cast<I*>(base + l.col_off), hdr.msize);
+        csr_.arr_val = AlignedBuffer<V>::borrow(reinterpret_cast<V*>(base + l.val_off), hdr.msize);
+        if (!structure_ok(csr_)) {
+            throw std::runtime_error(bad);
+        }
+        if (verify && !this->verify()) {
+            throw std::runtime_error("Checksum mismatch in " + path);
+        }
+    }
+
+    template<class V, class I>
+    bool CSRMapped<V, I>::verify() const {
+        CSRFileHeader hdr;
+        std::memcpy(&hdr, file_.data(), sizeof(hdr));
+        return csr_checksum(csr_) == hdr.checksum;
+    }
+
+
+
+    template<class V, class I>
+    struct RowBlockReader<V, I>::Source {
+        I rows{ 0 }, cols{ 0 };
+
+        virtual ~Source() = default;
+        // the rows from first on, block_size elements (rounded up to a whole row) or block_size rows at most
+        virtual BasicCSR<V, I> read(I first, std::size_t block_size) = 0;
+    };
+
+    namespace {
+        // binary CSR file: the row offsets of the block decide where it ends, then its elements are read
+        template<class V, class I>
+        class CSRBlockSource : public RowBlockReader<V, I>::Source {
+        public:
+            explicit CSRBlockSource(const std::string& path) : path_(path), in_(path, std::ios::binary) {
+                if (!in_) {
+                    throw std::runtime_error("Cannot open " + path);
+                }
+                in_.seekg(0, std::ios::end);
+                std::uint64_t size = static_cast<std::uint64_t>(in_.tellg());
+                char buf[sizeof(CSRFileHeader)] = {};
+                read_at(0, buf, std::min<std::uint64_t>(size, sizeof(buf)));
+                CSRFileHeader hdr = read_csr_header<V, I>(buf, size, path);
+                this->rows = static_cast<I>(hdr.row);
+                this->cols = static_cast<I>(hdr.col);
+                msize_ = static_cast<I>(hdr.msize);
+                layout_ = csr_layout(hdr.row, hdr.msize, sizeof(I), sizeof(V));
+                // as structure_ok() does for CSRMapped: the offsets run from 0 to msize, the blocks check the rest
+                I first_offset, last_offset;
+                read_at(layout_.row_off, &first_offset, sizeof(I));
+                read_at(layout_.row_off + static_cast<std::uint64_t>(hdr.row) * sizeof(I), &last_offset, sizeof(I));
+                if (first_offset != 0 || last_offset != msize_) {
+                    throw std::runtime_error("Not a binary CSR file: " + path);
+                }
+            }
+
+            BasicCSR<V, I> read(I first, std::size_t block_size) override {
+                std::size_t count = std::min<std::size_t>(block_size, static_cast<std::size_t>(this->rows - first));
+                // the offsets left over from the previous block start this one, unless the caller skipped rows
+                if (first != offsets_first_) {
+                    offsets_.clear();
+                    offsets_first_ = first;
+                }
+                if (offsets_.empty()) {
+                    load_offsets(std::min(count + 1, offset_chunk));
+                }
+                if (offsets_[0] > msize_) {
+                    throw std::runtime_error("Not a binary CSR file: " + path_);
+                }
+                std::size_t end = count;
+                for (std::size_t k = 1; k <= count; k++) {
+                    // offsets are read a chunk at a time as the element budget allows, not for block_size rows
+                    if (k == offsets_.size()) {
+                        load_offsets(std::min(count + 1, k + offset_chunk));
+                    }
+                    if (offsets_[k] < offsets_[k - 1] || offsets_[k] > msize_) {
+                        throw std::runtime_error("Not a binary CSR file: " + path_);
+                    }
+                    if (static_cast<std::size_t>(offsets_[k] - offsets_[0]) >= block_size) {
+                        end = k;
+                        break;
+                    }
+                }
+
+                BasicCSR<V, I> block;
+                I base = offsets_[0];
+                block.allocate(static_cast<I>(end), offsets_[end] - base);
+                block.col = this->cols;
+                for (std::size_t k = 0; k <= end; k++) {
+                    block.arr_row[k] = offsets_[k] - base;
+                }
+                read_at(layout_.col_off + static_cast<std::uint64_t>(base) * sizeof(I), block.arr_col.data(),
+                        block.arr_col.size() * sizeof(I));
+                read_at(layout_.val_off + static_cast<std::uint64_t>(base) * sizeof(V), block.arr_val.data(),
+                        block.arr_val.size() * sizeof(V));
+                if (!columns_ok(block, I{ 0 }, block.row)) {
+                    throw std::runtime_error("Not a binary CSR file: " + path_);
+                }
+                // the offset of row first + end and any read past it are kept for the next block
+                offsets_.erase(offsets_.begin(), offsets_.begin() + static_cast<std::ptrdiff_t>(end));
+                offsets_first_ = first + static_cast<I>(end);
+                return block;
+            }
+
+        private:
+            // row offsets read at once while looking for the end of a block
+            static constexpr std::size_t offset_chunk = std::size_t{ 1 } << 16;
+
+            // extends offsets_ to n offsets from row offsets_first_ on
+            void load_offsets(std::size_t n) {
+                std::size_t have = offsets_.size();
+                offsets_.resize(n);
+                read_at(layout_.row_off + (static_cast<std::uint64_t>(offsets_first_) + have) * sizeof(I),
+                        offsets_.data() + have, (n - have) * sizeof(I));
+            }
+
+            void read_at(std::uint64_t offset, void* to, std::size_t bytes) {
+                in_.seekg(static_cast<std::streamoff>(offset));
+                if (!in_.read(static_cast<char*>(to), static_cast<std::streamsize>(bytes))) {
+                    throw std::runtime_error("Cannot read " + path_);
+                }
+            }
+
+            std::string path_;
+            std::ifstream in_;
+            I msize_{ 0 };
+            CSRFileLayout layout_{};
+            std::vector<I> offsets_; // offsets of the rows from offsets_first_ on
+            I offsets_first_{ 0 };
+        };
+
+        // Matrix Market file: the elements are parsed up to the first one of the next block, which is kept
+        // for the next read; the pages already parsed are dropped from memory
+        template<class V, class I>
+        class MtxBlockSource : public RowBlockReader<V, I>::Source {
+        public:
+            explicit MtxBlockSource(const std::string& path) : file_(path), in_{ file_.data(), file_.data() + file_.size() } {
+                header_ = read_mtx_header<V, I>(in_);
+                if (header_.mirror) {
+                    in_.fail("symmetric matrices cannot be read in row blocks, load them with load_mtx");
+                }
+                this->rows = static_cast<I>(header_.rows);
+                this->cols = static_cast<I>(header_.cols);
+                left_ = header_.entries;
+            }
+
+            BasicCSR<V, I> read(I first, std::size_t block_size) override {
+                I limit = first + static_cast<I>(std::min<std::size_t>(block_size, static_cast<std::size_t>(this->rows - first)));
+                row_idx_.clear();
+                col_idx_.clear();
+                vals_.clear();
+                while (peek()) {
+                    if (next_row_ >= limit) {
+                        break;
+                    }
+                    if (!row_idx_.empty() && next_row_ != row_idx_.back() + first && row_idx_.size() >= block_size) {
+                        limit = next_row_;
+                        break;
+                    }
+                    row_idx_.push_back(next_row_ - first);
+                    col_idx_.push_back(next_col_);
+                    vals_.push_back(next_val_);
+                    has_next_ = false;
+                }
+                file_.release(static_cast<std::size_t>(in_.p - file_.data()));
+                return build_csr_from_coo<V, I>(limit - first, this->cols, row_idx_.data(), col_idx_.data(),
+                                                vals_.data(), static_cast<I>(row_idx_.size()));
+            }
+
+        private:
+            // parses the next element unless one is waiting; false after the last one
+            bool peek() {
+                if (has_next_) {
+                    return true;
+                }
+                if (left_ == 0) {
+                    if (!at_end_) {
+                        expect_end(in_);
+                        at_end_ = true;
+                    }
+                    return false;
+                }
+                I row;
+                read_mtx_entry(in_, header_, row, next_col_, next_val_);
+                left_--;
+                if (seen_ && row < last_row_) {
+                    in_.fail("elements must be listed in row order to be read in row blocks, load the file with load_mtx");
+                }
+                seen_ = true;
+                next_row_ = last_row_ = row;
+                has_next_ = true;
+                return true;
+            }
+
+            MappedFile file_;
+            Scanner in_;
+            MtxHeader header_{};
+            std::uint64_t left_{ 0 };
+            bool has_next_ = false, seen_ = false, at_end_ = false;
+            I next_row_{ 0 }, next_col_{ 0 }, last_row_{ 0 };
+            V next_val_{};
+            std::vector<I> row_idx_, col_idx_;
+            std::vector<V> vals_;
+        };
+    }
+
+    template<class V, class I>
+    RowBlockReader<V, I>::RowBlockReader(const std::string& path, std::size_t block_size)
+        : block_size_(std::max<std::size_t>(block_size, 1)) {
+        char magic[sizeof(csr_magic)] = {};
+        std::ifstream probe(path, std::ios::binary);
+        if (!probe) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        probe.read(magic, sizeof(magic));
+        if (std::memcmp(magic, csr_magic, sizeof(csr_magic)) == 0) {
+            source_ = std::make_unique<CSRBlockSource<V, I>>(path);
+        } else {
+            source_ = std::make_unique<MtxBlockSource<V, I>>(path);
+        }
+        rows_ = source_->rows;
+        cols_ = source_->cols;
+        if (rows_ > 0) {
+            read_ahead(0);
+        }
+    }
+
+    template<class V, class I>
+    RowBlockReader<V, I>::~RowBlockReader() {
+        if (pending_.valid()) {
+            pending_.wait();
+        }
+    }
+
+    template<class V, class I>
+    void RowBlockReader<V, I>::read_ahead(I first) {
+        pending_first_ = first;
+        // on its own thread, parsing and building serially: on the shared pool it would wait for the
+        // caller's kernels instead of running beside them
+        pending_ = std::async(std::launch::async, [this, first] {
+            BasicCSR<V, I> block;
+            run_serial([&] { block = source_->read(first, block_size_); });
+            return block;
+        });
+    }
+
+    template<class V, class I>
+    bool RowBlockReader<V, I>::next(BasicCSR<V, I>& block, I& first_row) {
+        if (!pending_.valid()) {
+            return false;
+        }
+        first_row = pending_first_;
+        block = pending_.get();
+        I next_first = first_row + block.row;
+        if (next_first < rows_) {
+            read_ahead(next_first);
+        }
+        return true;
+    }
+
+
+
+    template<class V, class I>
+    CSRFileWriter<V, I>::CSRFileWriter(const std::string& path, I rows, I cols)
+        : path_(path), out_(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc),
+          vals_(path + ".vals", std::ios::binary | std::ios::trunc), rows_(rows), cols_(cols) {
+        if (!out_ || !vals_) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        // arr_row[0]; the header is written by finish()
+        I zero{ 0 };
+        out_.seekp(sizeof(CSRFileHeader));
+        out_.write(reinterpret_cast<const char*>(&zero), sizeof(I));
+    }
+
+    template<class V, class I>
+    CSRFileWriter<V, I>::~CSRFileWriter() {
+        vals_.close();
+        std::remove((path_ + ".vals").c_str());
+    }
+
+    template<class V, class I>
+    void CSRFileWriter<V, I>::append(const BasicCSR<V, I>& block) {
+        if (block.row == 0) {
+            return; // nothing to write (a default block has no offsets at all)
+        }
+        if (block.col != cols_ || block.row > rows_ - written_) {
+            throw std::runtime_error("Block does not fit the matrix written to " + path_);
+        }
+        CSRFileLayout l = csr_layout(rows_, 0, sizeof(I), sizeof(V));
+        // the column indices start right after arr_row, whatever the final number of elements
+        std::vector<I> offsets(block.arr_row.begin() + 1, block.arr_row.end());
+        for (I& o : offsets) {
+            o += msize_;
+        }
+        out_.seekp(static_cast<std::streamoff>(l.row_off + (static_cast<std::uint64_t>(written_) + 1) * sizeof(I)));
+        out_.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(I));
+        out_.seekp(static_cast<std::streamoff>(l.col_off + static_cast<std::uint64_t>(msize_) * sizeof(I)));
+        out_.write(reinterpret_cast<const char*>(block.arr_col.data()), block.arr_col.size() * sizeof(I));
+        vals_.write(reinterpret_cast<const char*>(block.arr_val.data()), block.arr_val.size() * sizeof(V));
+        if (!out_ || !vals_) {
+            throw std::runtime_error("Cannot write " + path_);
+        }
+        written_ += block.row;
+        msize_ += block.msize;
+    }
+
+    template<class V, class I>
+    void CSRFileWriter<V, I>::finish() {
+        if (written_ != rows_) {
+            throw std::runtime_error("Not every row was written to " + path_);
+        }
+        CSRFileHeader hdr = make_csr_header<V, I>(rows_, cols_, msize_);
+        CSRFileLayout l = csr_layout(hdr.row, hdr.msize, sizeof(I), sizeof(V));
+        static const char zeros[64] = {};
+        auto pad = [&](std::uint64_t from, std::uint64_t to) {
+            out_.seekp(static_cast<std::streamoff>(from));
+            out_.write(zeros, static_cast<std::streamsize>(to - from));
+        };
+        pad(l.row_off + (hdr.row + 1) * sizeof(I), l.col_off);
+        pad(l.col_off + hdr.msize * sizeof(I), l.val_off);
+
+        // the values follow in chunks
+        vals_.close();
+        std::string vals_path = path_ + ".vals";
+        std::ifstream vals(vals_path, std::ios::binary);
+        std::vector<char> chunk(std::size_t{ 1 } << 20);
+        while (vals.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || vals.gcount() > 0) {
+            out_.write(chunk.data(), vals.gcount());
+        }
+        vals.close();
+        std::remove(vals_path.c_str());
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        out_.close();
+        if (!out_) {
+            throw std::runtime_error("Cannot write " + path_);
+        }
+
+        // the checksum over the finished file, read through a mapping rather than into memory
+        {
+            CSRMapped<V, I> written(path_);
+            hdr.checksum = csr_checksum(written.csr());
+        }
+        std::fstream patch(path_, std::ios::in | std::ios::out | std::ios::binary);
+        patch.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        if (!patch.flush()) {
+            throw std::runtime_error("Cannot write " + path_);
+        }
+    }
+
+
+
+    template<class V, class I>
+    void stream_specialfunc(const std::string& in_path, const std::string& out_path, std::size_t block_size) {
+        RowBlockReader<V, I> reader(in_path, block_size);
+        CSRFileWriter<V, I> writer(out_path, reader.rows(), reader.cols());
+        BasicCSR<V, I> block;
+        I first;
+        while (reader.next(block, first)) {
+            specialfunc(block);
+            writer.append(block);
+        }
+        writer.finish();
+    }
+
+    template<class V, class I>
+    void stream_row_reduction(const std::string& in_path, const std::string& out_path, RowReduction what,
+                              std::size_t block_size) {
+        RowBlockReader<V, I> reader(in_path, block_size);
+        std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot create " + out_path);
+        }
+        std::string text;
+        char num[64];
+        auto put = [&](auto x) {
+            auto [end, ec] = std::to_chars(num, num + sizeof(num), x);
+            text.append(num, end);
+            text += '\n';
+        };
+        BasicCSR<V, I> block;
+        I first;
+        while (reader.next(block, first)) {
+            text.clear();
+            if (what == RowReduction::nnz) {
+                for (I n : row_nnz(block)) {
+                    put(n);
+                }
+            } else if (what == RowReduction::argmin) {
+                std::vector<I> pos = row_argmin(block);
+                for (I i = 0; i < block.row; i++) {
+                    if (pos[i] == block.arr_row[i + 1]) {
+                        text += "-1\n";
+                    } else {
+                        put(block.arr_col[pos[i]]);
+                    }
+                }
+            } else {
+                std::vector<V> r = what == RowReduction::min ? row_min(block)
+                                 : what == RowReduction::max ? row_max(block) : row_sum(block);
+                for (V x : r) {
+                    put(x);
+                }
+            }
+            if (!out.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+                throw std::runtime_error("Cannot write " + out_path);
+            }
+        }
+    }
+
+
+#define PROG1_INSTANTIATE(T) \
+    template T NumberReader::next<T>(); \
+    template T NumberReader::next<T>(T, T);
+    PROG1_INSTANTIATE(int)
+    PROG1_INSTANTIATE(std::int64_t)
+    PROG1_INSTANTIATE(std::uint32_t)
+    PROG1_INSTANTIATE(std::uint64_t)
+    PROG1_INSTANTIATE(float)
+    PROG1_INSTANTIATE(double)
+#undef PROG1_INSTANTIATE
+
+#define PROG1_INSTANTIATE(V, I) \
+    template BasicCSR<V, I> read_csr_text<V, I>(NumberReader&); \
+    template BasicCSR<V, I> parse_mtx<V, I>(const char*, const char*); \
+    template BasicCSR<V, I> load_mtx<V, I>(const std::string&); \
+    template std::uint64_t csr_checksum<V, I>(const BasicCSR<V, I>&); \
+    template void save_csr<V, I>(const BasicCSR<V, I>&, const std::string&); \
+    template class CSRMapped<V, I>; \
+    template class RowBlockReader<V, I>; \
+    template class CSRFileWriter<V, I>; \
+    template void stream_specialfunc<V, I>(const std::string&, const std::string&, std::size_t); \
+    template void stream_row_reduction<V, I>(const std::string&, const std::string&, RowReduction, std::size_t);
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
@@ -0,0 +1,184 @@
+#ifndef OOPPROG1_PROG1IO_H
+#define OOPPROG1_PROG1IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // read-only memory mapping of a whole file (RAII)
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        // sequential = true hints the kernel for a single front-to-back pass
+        explicit MappedFile(const std::string& path, bool sequential = true);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        const char* data() const { return data_; }
+        std::size_t size() const { return size_; }
+        // drops the pages before offset from memory; they are read from the file again if touched
+        void release(std::size_t offset);
+
+    private:
+        const char* data_ = nullptr;
+        std::size_t size_{ 0 };
+    };
+
+    // whitespace separated numbers from a text held in memory, for piped input: parsed with std::from_chars,
+    // errors name the line and the column
+    class NumberReader {
+    public:
+        // takes the text over; name is used in the error messages
+        explicit NumberReader(std::string text, std::string name = "input");
+        // everything on the standard input
+        static NumberReader from_stdin();
+        static NumberReader from_file(const std::string& path);
+
+        template<class T>
+        T next();
+        // throws unless min <= value <= max
+        template<class T>
+        T next(T min, T max);
+        // throws unless only whitespace is left
+        void expect_end();
+        // throws unless count items of at least shortest bytes each (a separator included, but for the last)
+        // fit in the text left: a count read from the input is checked before anything is allocated for it
+        void expect_room(std::uint64_t count, std::size_t shortest);
+
+    private:
+        [[noreturn]] void fail(std::size_t at, const std::string& what) const;
+        void skip_space();
+
+        std::string text_;
+        std::string name_;
+        std::size_t pos_{ 0 };        // offsets, so that the reader can be moved
+        std::size_t line_start_{ 0 };
+        long long line_{ 1 };
+    };
+
+    // the text form input() reads: rows, columns, element count, then column, row, value of every element
+    template<class V = int, class I = int>
+    BasicCSR<V, I> read_csr_text(NumberReader& in);
+
+
+
+    // loads a Matrix Market coordinate file (integer or pattern, real too for floating point values;
+    // general, symmetric or skew-symmetric)
+    template<class V = int, class I = int>
+    BasicCSR<V, I> load_mtx(const std::string& path);
+    // same, from a text already in memory
+    template<class V = int, class I = int>
+    BasicCSR<V, I> parse_mtx(const char* begin, const char* end);
+
+
+
+    // binary CSR file: 64-byte header, then arr_row, arr_col and arr_val, each 64-byte aligned
+    struct CSRFileHeader {
+        char magic[8];           // "PROG1CSR"
+        std::uint32_t version;
+        std::uint32_t endian;    // 0x01020304 in the byte order of the writer
+        std::int64_t row, col, msize;
+        std::uint64_t checksum;  // csr_checksum() of the three arrays
+        std::uint32_t index_size, value_size;
+        std::uint32_t index_kind, value_kind; // 0 - signed integer, 1 - unsigned integer, 2 - floating point
+    };
+    static_assert(sizeof(CSRFileHeader) == 64, "CSRFileHeader must stay 64 bytes");
+
+    template<class V, class I>
+    std::uint64_t csr_checksum(const BasicCSR<V, I>& coord);
+    template<class V, class I>
+    void save_csr(const BasicCSR<V, I>& coord, const std::string& path);
+
+    // zero-copy view of a binary CSR file: the arrays are used in place in the mapping.
+    // csr() is read-only: the file must hold exactly the V and I types. The structure (offsets, column range
+    // and order) is always checked on opening, so a damaged file throws instead of sending the kernels astray
+    template<class V = int, class I = int>
+    class CSRMapped {
+    public:
+        // verify = true reads the whole file once to check the checksum
+        explicit CSRMapped(const std::string& path, bool verify = false);
+
+        const BasicCSR<V, I>& csr() const { return csr_; }
+        bool verify() const;
+
+    private:
+        MappedFile file_;
+        BasicCSR<V, I> csr_;
+    };
+
+
+
+    // out-of-core reading: the file is read in blocks of whole rows, each an ordinary CSR of block.row rows
+    // starting at first_row (column indices unchanged). The next block is read by a background thread while
+    // the caller works on the current one, so at most two blocks are in memory.
+    // Reads binary CSR files and general Matrix Market files that list the elements in row order (columns
+    // of a row in any order); other Matrix Market files throw and have to be read whole with load_mtx
+    template<class V = int, class I = int>
+    class RowBlockReader {
+    public:
+        struct Source;
+
+        // a block ends at the first row boundary after block_size elements, or after block_size rows
+        explicit RowBlockReader(const std::string& path, std::size_t block_size = std::size_t{ 1 } << 22);
+        RowBlockReader(const RowBlockReader&) = delete;
+        RowBlockReader& operator=(const RowBlockReader&) = delete;
+        ~RowBlockReader();
+
+        I rows() const { return rows_; }
+        I cols() const { return cols_; }
+        // moves the next block into block and returns true, false once all rows are read
+        bool next(BasicCSR<V, I>& block, I& first_row);
+
+    private:
+        void read_ahead(I first);
+
+        std::unique_ptr<Source> source_;
+        std::future<BasicCSR<V, I>> pending_;
+        I pending_first_{ 0 };
+        I rows_{ 0 }, cols_{ 0 };
+        std::size_t block_size_;
+    };
+
+    // writes a binary CSR file block of rows by block of rows, without the whole matrix in memory.
+    // The values go to path + ".vals" until finish() puts them after the column indices
+    template<class V = int, class I = int>
+    class CSRFileWriter {
+    public:
+        CSRFileWriter(const std::string& path, I rows, I cols);
+        ~CSRFileWriter(); // removes the values file
+        // the next block.row rows of the matrix
+        void append(const BasicCSR<V, I>& block);
+        // completes the file once every row is appended
+        void finish();
+
+    private:
+        std::string path_;
+        std::fstream out_;
+        std::ofstream vals_;
+        I rows_, cols_;
+        I written_{ 0 }, msize_{ 0 };
+    };
+
+    // specialfunc() of a matrix that need not fit in memory: every block of in_path is filtered
+    // and appended to the binary CSR file out_path
+    template<class V = int, class I = int>
+    void stream_specialfunc(const std::string& in_path, const std::string& out_path,
+                            std::size_t block_size = std::size_t{ 1 } << 22);
+
+    enum class RowReduction { min, max, sum, nnz, argmin };
+    // one row reduction (see row_min() etc.) of a matrix that need not fit in memory, written to out_path
+    // as text, one row per line; argmin gives the column of the row minimum, -1 for an empty row
+    template<class V = int, class I = int>
+    void stream_row_reduction(const std::string& in_path, const std::string& out_path, RowReduction what,
+                              std::size_t block_size = std::size_t{ 1 } << 22);
+}
+
+#endif //OOPPROG1_PROG1IO_H
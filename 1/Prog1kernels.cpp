@@ -0,0 +1,597 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1simd.h"
+
+
+namespace Prog1 {
+    namespace {
+        template<class V, class I>
+        V dot_row_scalar(const V* val, const I* col, I begin, I end, const V* x) {
+            V sum{ 0 };
+            for (I k = begin; k < end; k++) {
+                sum += val[k] * x[col[k]];
+            }
+            return sum;
+        }
+
+#ifdef PROG1_HAVE_AVX2_PATH
+        // gathers take 32-bit signed lane indices, so these are used only for 32-bit
+        // index types and matrices with fewer than 2^31 columns
+        template<class I>
+        __attribute__((target("avx2")))
+        int dot_row_avx2(const int* val, const I* col, I begin, I end, const int* x) {
+            __m256i acc = _mm256_setzero_si256();
+            I k = begin;
+            for (; k + 8 <= end; k += 8) {
+                __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + k));
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(val + k));
+                __m256i xs = _mm256_i32gather_epi32(x, idx, 4);
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v, xs));
+            }
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtsi128_si32(s) + dot_row_scalar(val, col, k, end, x);
+        }
+
+        template<class I>
+        __attribute__((target("avx2,fma")))
+        float dot_row_avx2(const float* val, const I* col, I begin, I end, const float* x) {
+            __m256 acc = _mm256_setzero_ps();
+            I k = begin;
+            for (; k + 8 <= end; k += 8) {
+                __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + k));
+                __m256 v = _mm256_loadu_ps(val + k);
+                acc = _mm256_fmadd_ps(v, _mm256_i32gather_ps(x, idx, 4), acc);
+            }
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+            return _mm_cvtss_f32(s) + dot_row_scalar(val, col, k, end, x);
+        }
+
+        template<class I>
+        __attribute__((target("avx2,fma")))
+        double dot_row_avx2(const double* val, const I* col, I begin, I end, const double* x) {
+            __m256d acc = _mm256_setzero_pd();
+            const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            I k = begin;
+            for (; k + 4 <= end; k += 4) {
+                __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(col + k));
+                __m256d v = _mm256_loadu_pd(val + k);
+                acc = _mm256_fmadd_pd(v, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, idx, all, 8), acc);
+            }
+            __m128d s = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+            s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+            return _mm_cvtsd_f64(s) + dot_row_scalar(val, col, k, end, x);
+        }
+#endif
+
+        template<class V, class I>
+        using DotRow = V (*)(const V*, const I*, I, I, const V*);
+
+        template<class V, class I>
+        DotRow<V, I> pick_dot_row(const CSRView<V, I>& view) {
+#ifdef PROG1_HAVE_AVX2_PATH
+            constexpr bool vector_types = std::is_same_v<V, int> || std::is_same_v<V, float> || std::is_same_v<V, double>;
+            if constexpr (vector_types && sizeof(I) == 4) {
+                if (cpu_has_avx2() && static_cast<std::uint64_t>(view.col) <= std::numeric_limits<int>::max()) {
+                    return dot_row_avx2<I>;
+                }
+            }
+#endif
+            return dot_row_scalar<V, I>;
+        }
+
+        template<class V, class I>
+        void spmv_rows(const CSRView<V, I>& view, const V* x, V* y, V alpha, V beta, I first, I last, DotRow<V, I> dot) {
+            for (I i = first; i < last; i++) {
+                V ax = dot(view.arr_val, view.arr_col, view.row_begin(i), view.row_end(i), x);
+                y[i] = beta == V{ 0 } ? alpha * ax : alpha * ax + beta * y[i];
+            }
+        }
+
+
+        enum class Reduce { min, max, sum };
+
+        template<Reduce R, class V>
+        V combine(V a, V b) {
+            if constexpr (R == Reduce::min) {
+                return b < a ? b : a;
+            } else if constexpr (R == Reduce::max) {
+                return a < b ? b : a;
+            } else {
+                return a + b;
+            }
+        }
+
+        // reduction of val[0 .. n), n > 0
+        template<Reduce R, class V>
+        V reduce_scalar(const V* val, std::size_t n) {
+            V acc = val[0];
+            for (std::size_t k = 1; k < n; k++) {
+                acc = combine<R>(acc, val[k]);
+            }
+            return acc;
+        }
+
+#ifdef PROG1_HAVE_AVX2_PATH
+        // AVX2 lane operations of the value types the reductions are vectorized for
+        struct LanesInt {
+            using value = int;
+            using reg = __m256i;
+            static constexpr std::size_t width = 8;
+            __attribute__((target("avx2"))) static reg load(const int* p) {
+                return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            }
+            __attribute__((target("avx2"))) static void store(int* p, reg r) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r);
+            }
+            template<Reduce R>
+            __attribute__((target("avx2"))) static reg apply(reg a, reg b) {
+                if constexpr (R == Reduce::min) {
+                    return _mm256_min_epi32(a, b);
+                } else if constexpr (R == Reduce::max) {
+                    return _mm256_max_epi32(a, b);
+                } else {
+                    return _mm256_add_epi32(a, b);
+                }
+            }
+        };
+
+        struct LanesFloat {
+            using value = float;
+            using reg = __m256;
+            static constexpr std::size_t width = 8;
+            __attribute__((target("avx2"))) static reg load(const float* p) { return _mm256_loadu_ps(p); }
+            __attribute__((target("avx2"))) static void store(float* p, reg r) { _mm256_storeu_ps(p, r); }
+            template<Reduce R>
+            __attribute__((target("avx2"))) static reg apply(reg a, reg b) {
+                if constexpr (R == Reduce::min) {
+                    return _mm256_min_ps(a, b);
+                } else if constexpr (R == Reduce::max) {
+                    return _mm256_max_ps(a, b);
+                } else {
+                    return _mm256_add_ps(a, b);
+                }
+            }
+        };
+
+        struct LanesDouble {
+            using value = double;
+            using reg = __m256d;
+            static constexpr std::size_t width = 4;
+            __attribute__((target("avx2"))) static reg load(const double* p) { return _mm256_loadu_pd(p); }
+            __attribute__((target("avx2"))) static void store(double* p, reg r) { _mm256_storeu_pd(p, r); }
+            template<Reduce R>
+            __attribute__((target("avx2"))) static reg apply(reg a, reg b) {
+                if constexpr (R == Reduce::min) {
+                    return _mm256_min_pd(a, b);
+                } else if constexpr (R == Reduce::max) {
+                    return _mm256_max_pd(a, b);
+                } else {
+                    return _mm256_add_pd(a, b);
+                }
+            }
+        };
+
+        // one accumulator register over the whole lanes, then the lanes and the tail are folded in scalar;
+        // short rows (the common case) go straight to the scalar loop
+        template<Reduce R, class L>
+        __attribute__((target("avx2")))
+        typename L::value reduce_avx2(const typename L::value* val, std::size_t n) {
+            using V = typename L::value;
+            if (n < 2 * L::width) {
+                return reduce_scalar<R>(val, n);
+            }
+            typename L::reg acc = L::load(val);
+            std::size_t k = L::width;
+            for (; k + L::width <= n; k += L::width) {
+                acc = L::template apply<R>(acc, L::load(val + k));
+            }
+            V lanes[L::width];
+            L::store(lanes, acc);
+            V result = reduce_scalar<R>(lanes, L::width);
+            for (; k < n; k++) {
+                result = combine<R>(result, val[k]);
+            }
+            return result;
+        }
+#endif
+
+        template<class V>
+        using Reducer = V (*)(const V*, std::size_t);
+
+        template<Reduce R, class V>
+        Reducer<V> pick_reducer() {
+#ifdef PROG1_HAVE_AVX2_PATH
+            if (cpu_has_avx2()) {
+                if constexpr (std::is_same_v<V, int>) {
+                    return reduce_avx2<R, LanesInt>;
+                } else if constexpr (std::is_same_v<V, float>) {
+                    return reduce_avx2<R, LanesFloat>;
+                } else if constexpr (std::is_same_v<V, double>) {
+                    return reduce_avx2<R, LanesDouble>;
+                }
+            }
+#endif
+            return reduce_scalar<R, V>;
+        }
+
+        // out[i] = f(row_begin(i), row_end(i)) for every row, rows split into parts of equal work
+        template<class T, class V, class I, class F>
+        std::vector<T> map_rows(const CSRView<V, I>& view, F f) {
+            std::vector<T> out(view.row);
+            int parts = static_cast<std::size_t>(view.msize) < parallel_min_nnz ? 1 : thread_count();
+            std::vector<I> bounds = partition_rows(view, parts);
+            parallel_for(parts, [&](int p) {
+                for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                    out[i] = f(view.row_begin(i), view.row_end(i));
+                }
+            });
+            return out;
+        }
+
+        template<Reduce R, class V, class I>
+        std::vector<V> reduce_rows(const CSRView<V, I>& view) {
+            Reducer<V> reduce = pick_reducer<R, V>();
+            const V* val = view.arr_val;
+            return map_rows<V>(view, [&](I begin, I end) {
+                return begin == end ? V{ 0 } : reduce(val + begin, static_cast<std::size_t>(end - begin));
+            });
+        }
+    }
+
+
+
+    template<class V, class I>
+    std::vector<I> partition_rows(const BasicCSR<V, I>& coord, int parts) {
+        return partition_offsets(coord.arr_row.data(), coord.row, parts);
+    }
+
+    template<class V, class I>
+    std::vector<I> partition_rows(const CSRView<V, I>& view, int parts) {
+        return partition_offsets(view.arr_row, view.row, parts);
+    }
+
+    template<class I>
+    std::vector<I> partition_offsets(const I* offsets, I rows, int parts) {
+        parts = std::max(1, parts);
+        std::vector<I> bounds(parts + 1);
+        // row i starts at position i + offsets[i] - offsets[0] of the merged (rows, nonzeros) sequence,
+        // which grows with i, so each boundary is a binary search
+        bounds[0] = 0;
+        bounds[parts] = rows;
+        if (parts == 1) {
+            return bounds; // offsets may be empty then (a default constructed matrix)
+        }
+        const std::uint64_t origin = offsets[0];
+        std::uint64_t total = static_cast<std::uint64_t>(rows) + static_cast<std::uint64_t>(offsets[rows]) - origin;
+        for (int p = 1; p < parts; p++) {
+            std::uint64_t target = static_cast<std::uint64_t>(static_cast<long double>(total) * p / parts);
+            I lo = bounds[p - 1], hi = rows;
+            while (lo < hi) {
+                I mid = lo + (hi - lo) / 2;
+                if (static_cast<std::uint64_t>(mid) + static_cast<std::uint64_t>(offsets[mid]) - origin < target) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            bounds[p] = lo;
+        }
+        return bounds;
+    }
+
+    template<class V, class I>
+    std::vector<CSRView<V, I>> split_rows(const BasicCSR<V, I>& coord, int parts) {
+        std::vector<I> bounds = partition_rows(coord, parts);
+        std::vector<CSRView<V, I>> views;
+        views.reserve(bounds.size() - 1);
+        for (std::size_t p = 0; p + 1 < bounds.size(); p++) {
+            views.emplace_back(coord, bounds[p], bounds[p + 1]);
+        }
+        return views;
+    }
+
+    template<class V, class I>
+    void spmv(const BasicCSR<V, I>& coord, const V* x, V* y) {
+        spmv(CSRView<V, I>(coord), x, y, V{ 1 }, V{ 0 });
+    }
+
+    template<class V, class I>
+    void spmv(const BasicCSR<V, I>& coord, const V* x, V* y, V alpha, V beta) {
+        spmv(CSRView<V, I>(coord), x, y, alpha, beta);
+    }
+
+    template<class V, class I>
+    void spmv(const CSRView<V, I>& view, const V* x, V* y) {
+        spmv(view, x, y, V{ 1 }, V{ 0 });
+    }
+
+    template<class V, class I>
+    void spmv(const CSRView<V, I>& view, const V* x, V* y, V alpha, V beta) {
+        DotRow<V, I> dot = pick_dot_row(view);
+        int parts = static_cast<std::size_t>(view.msize) < parallel_min_nnz ? 1 : thread_count();
+        if (parts == 1) {
+            spmv_rows(view, x, y, alpha, beta, I{ 0 }, view.row, dot);
+            return;
+        }
+        std::vector<I> bounds = partition_rows(view, parts);
+        parallel_for(parts, [&](int p) {
+            spmv_rows(view, x, y, alpha, beta, bounds[p], bounds[p + 1], dot);
+        });
+    }
+
+
+    template<class V, class I>
+    std::vector<V> row_min(const BasicCSR<V, I>& coord) {
+        return reduce_rows<Reduce::min>(CSRView<V, I>(coord));
+    }
+
+    template<class V, class I>
+    std::vector<V> row_max(const BasicCSR<V, I>& coord) {
+        return reduce_rows<Reduce::max>(CSRView<V, I>(coord));
+    }
+
+    template<class V, class I>
+    std::vector<V> row_sum(const BasicCSR<V, I>& coord) {
+        return reduce_rows<Reduce::sum>(CSRView<V, I>(coord));
+    }
+
+    template<class V, class I>
+    std::vector<I> row_argmin(const BasicCSR<V, I>& coord) {
+        return row_argmin(CSRView<V, I>(coord));
+    }
+
+    template<class V, class I>
+    std::vector<I> row_nnz(const BasicCSR<V, I>& coord) {
+        return row_nnz(CSRView<V, I>(coord));
+    }
+
+    template<class V, class I>
+    std::vector<V> row_min(const CSRView<V, I>& view) {
+        return reduce_rows<Reduce::min>(view);
+    }
+
+    template<class V, class I>
+    std::vector<V> row_max(const CSRView<V, I>& view) {
+        return reduce_rows<Reduce::max>(view);
+    }
+
+    template<class V, class I>
+    std::vector<V> row_sum(const CSRView<V, I>& view) {
+        return reduce_rows<Reduce::sum>(view);
+    }
+
+    template<class V>
+    std::size_t first_min(const V* val, std::size_t n) {
+        if (n == 0) {
+            return 0;
+        }
+        // vectorized minimum, then the first element equal to it
+        V least = pick_reducer<Reduce::min, V>()(val, n);
+        const V* first = std::find(val, val + n, least);
+        if (first != val + n) {
+            return static_cast<std::size_t>(first - val);
+        }
+        // NaN in the row: the minimum is not comparable, pick it the scalar way
+        std::size_t index = 0;
+        for (std::size_t j = 1; j < n; j++) {
+            if (val[j] < val[index]) {
+                index = j;
+            }
+        }
+        return index;
+    }
+
+    template<class V, class I>
+    std::vector<I> row_argmin(const CSRView<V, I>& view) {
+        const V* val = view.arr_val;
+        return map_rows<I>(view, [&](I begin, I end) {
+            return static_cast<I>(begin + first_min(val + begin, static_cast<std::size_t>(end - begin)));
+        });
+    }
+
+    template<class V, class I>
+    std::vector<I> row_nnz(const CSRView<V, I>& view) {
+        return map_rows<I>(view, [](I begin, I end) { return end - begin; });
+    }
+
+
+    template<class V, class I>
+    BasicCSR<V, I> spgemm(const BasicCSR<V, I>& a, const BasicCSR<V, I>& b) {
+        if (a.col != b.row) {
+            throw std::runtime_error("Matrix sizes do not match for multiplication");
+        }
+        BasicCSR<V, I> c;
+        c.allocate(a.row, 0);
+        c.col = b.col;
+        c.arr_row[0] = 0;
+
+        int parts = static_cast<std::size_t>(a.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_rows(a, parts);
+        const I none = std::numeric_limits<I>::max();
+
+        // symbolic pass: distinct columns of every row of C, marker[j] == i means j is already counted
+        parallel_for(parts, [&](int p) {
+            std::vector<I> marker(b.col, none);
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                I count{ 0 };
+                for (I ka = a.arr_row[i]; ka < a.arr_row[i + 1]; ka++) {
+                    I r = a.arr_col[ka];
+                    for (I kb = b.arr_row[r]; kb < b.arr_row[r + 1]; kb++) {
+                        I j = b.arr_col[kb];
+                        if (marker[j] != i) {
+                            marker[j] = i;
+                            count++;
+                        }
+                    }
+                }
+                c.arr_row[i + 1] = count;
+            }
+        });
+        for (I i = 0; i < c.row; i++) {
+            c.arr_row[i + 1] += c.arr_row[i];
+        }
+        c.resize_nnz(c.arr_row[c.row]);
+
+        // numeric pass: accumulate the row densely, then write its columns in order
+        parallel_for(parts, [&](int p) {
+            std::vector<V> acc(b.col);
+            std::vector<I> marker(b.col, none);
+            std::vector<I> touched;
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                touched.clear();
+                for (I ka = a.arr_row[i]; ka < a.arr_row[i + 1]; ka++) {
+                    I r = a.arr_col[ka];
+                    V av = a.arr_val[ka];
+                    for (I kb = b.arr_row[r]; kb < b.arr_row[r + 1]; kb++) {
+                        I j = b.arr_col[kb];
+                        if (marker[j] != i) {
+                            marker[j] = i;
+                            acc[j] = av * b.arr_val[kb];
+                            touched.push_back(j);
+                        } else {
+                            acc[j] += av * b.arr_val[kb];
+                        }
+                    }
+                }
+                std::sort(touched.begin(), touched.end());
+                I pos = c.arr_row[i];
+                for (I j : touched) {
+                    c.arr_col[pos] = j;
+                    c.arr_val[pos] = acc[j];
+                    pos++;
+                }
+            }
+        });
+        return c;
+    }
+
+
+    template<class V, class I>
+    BasicCSR<V, I> transpose(const BasicCSR<V, I>& coord) {
+        BasicCSR<V, I> t;
+        t.allocate(coord.col, coord.msize);
+        t.col = coord.row;
+        const std::size_t cols = coord.col;
+        if (coord.row == 0) {
+            // no rows (a default or erased matrix has no offsets either): cols empty rows
+            std::fill(t.arr_row.data(), t.arr_row.data() + cols + 1, I{ 0 });
+            return t;
+        }
+
+        int parts = static_cast<std::size_t>(coord.msize) < parallel_min_nnz ? 1 : thread_count();
+        // every part keeps a histogram of all the columns: no more parts than keep them within O(msize)
+        parts = static_cast<int>(std::clamp<std::size_t>(coord.msize / std::max<std::size_t>(cols, 1), 1, parts));
+        std::vector<I> bounds = partition_rows(coord, parts);
+        // hist[p * cols + j]: elements of column j in row part p, later the write cursor of that part
+        std::vector<I> hist(parts * cols, 0);
+
+        parallel_for(parts, [&](int p) {
+            I* h = hist.data() + p * cols;
+            for (I k = coord.arr_row[bounds[p]]; k < coord.arr_row[bounds[p + 1]]; k++) {
+                h[coord.arr_col[k]]++;
+            }
+        });
+
+        // prefix sum over (column, part) in column-major order, in column chunks
+        std::vector<I> chunk_start(parts + 1, 0);
+        auto chunk = [&](int c) { return cols * c / parts; };
+        parallel_for(parts, [&](int c) {
+            I total{ 0 };
+            for (std::size_t j = chunk(c); j < chunk(c + 1); j++) {
+                for (int p = 0; p < parts; p++) {
+                    total += hist[p * cols + j];
+                }
+            }
+            chunk_start[c + 1] = total;
+        });
+        for (int c = 0; c < parts; c++) {
+            chunk_start[c + 1] += chunk_start[c];
+        }
+        parallel_for(parts, [&](int c) {
+            I pos = chunk_start[c];
+            for (std::size_t j = chunk(c); j < chunk(c + 1); j++) {
+                t.arr_row[j] = pos;
+                for (int p = 0; p < parts; p++) {
+                    I count = hist[p * cols + j];
+                    hist[p * cols + j] = pos;
+                    pos += count;
+                }
+            }
+        });
+        t.arr_row[cols] = coord.msize;
+
+        // scatter: parts go in row order, so every transposed row comes out sorted
+        parallel_for(parts, [&](int p) {
+            I* cursor = hist.data() + p * cols;
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                for (I k = coord.arr_row[i]; k < coord.arr_row[i + 1]; k++) {
+                    I pos = cursor[coord.arr_col[k]]++;
+                    t.arr_col[pos] = i;
+                    t.arr_val[pos] = coord.arr_val[k];
+                }
+            }
+        });
+        return t;
+    }
+
+
+
+    template<class V, class I>
+    const BasicCSR<V, I>& CSRWithTranspose<V, I>::columns() const {
+        std::call_once(transposed_, [this] { columns_ = transpose(rows_); });
+        return columns_;
+    }
+
+    template<class V, class I>
+    void CSRWithTranspose<V, I>::column_sums(V* sums) const {
+        std::vector<V> s = row_sum(columns());
+        std::copy(s.begin(), s.end(), sums);
+    }
+
+    template<class V, class I>
+    void CSRWithTranspose<V, I>::spmv_transposed(const V* x, V* y) const {
+        spmv(columns(), x, y);
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template std::vector<I> partition_rows<V, I>(const BasicCSR<V, I>&, int); \
+    template std::vector<I> partition_rows<V, I>(const CSRView<V, I>&, int); \
+    template std::vector<CSRView<V, I>> split_rows<V, I>(const BasicCSR<V, I>&, int); \
+    template void spmv<V, I>(const BasicCSR<V, I>&, const V*, V*); \
+    template void spmv<V, I>(const BasicCSR<V, I>&, const V*, V*, V, V); \
+    template void spmv<V, I>(const CSRView<V, I>&, const V*, V*); \
+    template void spmv<V, I>(const CSRView<V, I>&, const V*, V*, V, V); \
+    template std::vector<V> row_min<V, I>(const BasicCSR<V, I>&); \
+    template std::vector<V> row_max<V, I>(const BasicCSR<V, I>&); \
+    template std::vector<V> row_sum<V, I>(const BasicCSR<V, I>&); \
+    template std::vector<I> row_argmin<V, I>(const BasicCSR<V, I>&); \
+    template std::vector<I> row_nnz<V, I>(const BasicCSR<V, I>&); \
+    template std::vector<V> row_min<V, I>(const CSRView<V, I>&); \
+    template std::vector<V> row_max<V, I>(const CSRView<V, I>&); \
+    template std::vector<V> row_sum<V, I>(const CSRView<V, I>&); \
+    template std::vector<I> row_argmin<V, I>(const CSRView<V, I>&); \
+    template std::vector<I> row_nnz<V, I>(const CSRView<V, I>&); \
+    template BasicCSR<V, I> spgemm<V, I>(const BasicCSR<V, I>&, const BasicCSR<V, I>&); \
+    template BasicCSR<V, I> transpose<V, I>(const BasicCSR<V, I>&); \
+    template class CSRWithTranspose<V, I>;
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+
+    template std::size_t first_min<int>(const int*, std::size_t);
+    template std::size_t first_min<std::int64_t>(const std::int64_t*, std::size_t);
+    template std::size_t first_min<float>(const float*, std::size_t);
+    template std::size_t first_min<double>(const double*, std::size_t);
+
+    template std::vector<int> partition_offsets<int>(const int*, int, int);
+    template std::vector<std::uint32_t> partition_offsets<std::uint32_t>(const std::uint32_t*, std::uint32_t, int);
+    template std::vector<std::uint64_t> partition_offsets<std::uint64_t>(const std::uint64_t*, std::uint64_t, int);
+}
@@ -0,0 +1,100 @@
+#ifndef OOPPROG1_PROG1KERNELS_H
+#define OOPPROG1_PROG1KERNELS_H
+
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // splits the rows into parts with about equal (rows + nnz) work each (merge-path over arr_row).
+    // Returns parts + 1 row boundaries, the first is 0 and the last is coord.row
+    template<class V, class I>
+    std::vector<I> partition_rows(const BasicCSR<V, I>& coord, int parts);
+    template<class V, class I>
+    std::vector<I> partition_rows(const CSRView<V, I>& view, int parts);
+    // same over any row offset array: offsets has rows + 1 elements, offsets[rows] - offsets[0] is the element count
+    template<class I>
+    std::vector<I> partition_offsets(const I* offsets, I rows, int parts);
+    // views of parts row ranges with about equal work (see partition_rows), for handing one matrix out to workers
+    template<class V, class I>
+    std::vector<CSRView<V, I>> split_rows(const BasicCSR<V, I>& coord, int parts);
+
+    // y = A * x; x has coord.col elements, y has coord.row elements
+    template<class V, class I>
+    void spmv(const BasicCSR<V, I>& coord, const V* x, V* y);
+    // y = alpha * A * x + beta * y (y is not read when beta == 0)
+    template<class V, class I>
+    void spmv(const BasicCSR<V, I>& coord, const V* x, V* y, V alpha, V beta);
+    // the same for the rows of a view: x has view.col elements, y has view.row elements (y[0] is the first row
+    // of the view)
+    template<class V, class I>
+    void spmv(const CSRView<V, I>& view, const V* x, V* y);
+    template<class V, class I>
+    void spmv(const CSRView<V, I>& view, const V* x, V* y, V alpha, V beta);
+
+    // per-row reductions over the stored elements (implicit zeros do not take part), rows are processed
+    // in parallel and every result has coord.row entries. An empty row gives V{ 0 }; NaN values are unordered,
+    // so the minimum / maximum of a row holding one is unspecified
+    template<class V, class I>
+    std::vector<V> row_min(const BasicCSR<V, I>& coord);
+    template<class V, class I>
+    std::vector<V> row_max(const BasicCSR<V, I>& coord);
+    template<class V, class I>
+    std::vector<V> row_sum(const BasicCSR<V, I>& coord);
+    // position of the first minimum of val[0 .. n), n when n == 0: the vectorized minimum, then a search for it.
+    // Shared by row_argmin and the pipeline stages that look for a row minimum
+    template<class V>
+    std::size_t first_min(const V* val, std::size_t n);
+    // position in arr_col / arr_val of the first minimum of each row, arr_row[i + 1] for an empty row i
+    template<class V, class I>
+    std::vector<I> row_argmin(const BasicCSR<V, I>& coord);
+    // number of stored elements of each row
+    template<class V, class I>
+    std::vector<I> row_nnz(const BasicCSR<V, I>& coord);
+    // the same for the rows of a view; row_argmin gives positions in view.arr_col / view.arr_val
+    template<class V, class I>
+    std::vector<V> row_min(const CSRView<V, I>& view);
+    template<class V, class I>
+    std::vector<V> row_max(const CSRView<V, I>& view);
+    template<class V, class I>
+    std::vector<V> row_sum(const CSRView<V, I>& view);
+    template<class V, class I>
+    std::vector<I> row_argmin(const CSRView<V, I>& view);
+    template<class V, class I>
+    std::vector<I> row_nnz(const CSRView<V, I>& view);
+
+    // C = A * B (Gustavson): a symbolic pass sizes every row of C exactly, a numeric pass fills it
+    // with a dense per-thread accumulator. Rows of C are sorted by column
+    template<class V, class I>
+    BasicCSR<V, I> spgemm(const BasicCSR<V, I>& a, const BasicCSR<V, I>& b);
+
+    // CSR of the transposed matrix (= CSC of the original): per-thread column histograms, then one scatter.
+    // Rows of the result are sorted by column
+    template<class V, class I>
+    BasicCSR<V, I> transpose(const BasicCSR<V, I>& coord);
+
+    // matrix together with its transpose, built on the first column access and kept,
+    // so that column operations cost the same as row ones
+    template<class V, class I>
+    class CSRWithTranspose {
+    public:
+        explicit CSRWithTranspose(BasicCSR<V, I> coord) : rows_(std::move(coord)) {}
+
+        const BasicCSR<V, I>& rows() const { return rows_; }
+        // transposed matrix, its row j is column j of the original
+        const BasicCSR<V, I>& columns() const;
+
+        // sums[j] = sum of column j (sums has rows().col elements)
+        void column_sums(V* sums) const;
+        // y = A^T * x; x has rows().row elements, y has rows().col elements
+        void spmv_transposed(const V* x, V* y) const;
+
+    private:
+        BasicCSR<V, I> rows_;
+        mutable BasicCSR<V, I> columns_;
+        mutable std::once_flag transposed_;
+    };
+}
+
+#endif //OOPPROG1_PROG1KERNELS_H
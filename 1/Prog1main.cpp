@@ -1,13 +1,36 @@
-﻿#include <iostream>
+﻿#include <fstream>
+#include <iostream>
+#include <string>
 #include "Prog1.h"
+#include "Prog1io.h"
+#include "Prog1stats.h"
 
 using namespace Prog1;
 
+// Usage: Prog1 [--stats[=FILE]] [matrix.mtx]
+// --stats writes the phase times and counters as JSON to FILE, or to stderr
 // основная функция
-int main() {
+int main(int argc, char* argv[]) {
     CSR coord;
+    std::string path, stats_file;
+    bool want_stats = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stats" || arg.rfind("--stats=", 0) == 0) {
+            want_stats = true;
+            stats_file = arg.size() > 8 ? arg.substr(8) : "";
+        } else if (arg.rfind("--", 0) == 0) {
+            // a mistyped option is not a file name
+            std::cerr << "Unknown option " << arg << std::endl
+                      << "Usage: Prog1 [--stats[=FILE]] [matrix.mtx]" << std::endl;
+            return 1;
+        } else {
+            path = arg;
+        }
+    }
     try {
-        coord = input();
+        // matrix from a Matrix Market file if one is given, otherwise from the keyboard
+        coord = !path.empty() ? load_mtx(path) : input();
         std::cout << "Old matrix" << std::endl;
         //made_and_print(coord);
         output(coord);
@@ -16,6 +39,14 @@ int main() {
         //made_and_print(coord);
         output(coord);
         erase(coord);
+        if (want_stats) {
+            if (stats_file.empty()) {
+                std::cerr << stats().to_json() << std::endl;
+            } else if (!(std::ofstream(stats_file) << stats().to_json() << std::endl)) {
+                std::cerr << "Cannot write " << stats_file << std::endl;
+                return 1;
+            }
+        }
     }
     catch (const std::bad_alloc& ba) { // в случае ошибок выделения памяти
         std::cerr << "Not enough memory" << std::endl;
@@ -0,0 +1,160 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Prog1parallel.h"
+
+namespace Prog1 {
+    namespace {
+        // true on pool workers and on a caller while it runs tasks
+        thread_local bool inside_task = false;
+
+        struct Job {
+            const std::function<void(int)>* task;
+            int n;
+            std::atomic<int> next{ 0 };
+            std::atomic<int> done{ 0 };
+            std::exception_ptr error;
+            std::mutex error_lock;
+
+            // claims and runs tasks until none are left
+            void run() {
+                int i;
+                while ((i = next.fetch_add(1)) < n) {
+                    try {
+                        (*task)(i);
+                    }
+                    catch (...) {
+                        std::lock_guard<std::mutex> lock(error_lock);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    done.fetch_add(1);
+                }
+            }
+        };
+
+        class ThreadPool {
+        public:
+            ThreadPool() {
+                // PROG1_THREADS overrides the number of hardware threads
+                int total = static_cast<int>(std::thread::hardware_concurrency());
+                if (const char* env = std::getenv("PROG1_THREADS")) {
+                    total = std::atoi(env);
+                }
+                int workers = total > 1 ? total - 1 : 0;
+                for (int i = 0; i < workers; i++) {
+                    threads_.emplace_back([this] { work(); });
+                }
+            }
+
+            ~ThreadPool() {
+                {
+                    std::lock_guard<std::mutex> lock(lock_);
+                    stop_ = true;
+                }
+                wake_.notify_all();
+                for (auto& t : threads_) {
+                    t.join();
+                }
+            }
+
+            int size() const {
+                return static_cast<int>(threads_.size()) + 1;
+            }
+
+            void run(int n, const std::function<void(int)>& task) {
+                std::lock_guard<std::mutex> submit(submit_lock_); // one job at a time
+                auto job = std::make_shared<Job>();
+                job->task = &task;
+                job->n = n;
+                {
+                    std::lock_guard<std::mutex> lock(lock_);
+                    job_ = job;
+                    generation_++;
+                }
+                wake_.notify_all();
+
+                inside_task = true;
+                job->run();
+                inside_task = false;
+                {
+                    std::unique_lock<std::mutex> lock(lock_);
+                    finished_.wait(lock, [&] { return job->done.load() == n; });
+                    job_.reset();
+                }
+                if (job->error) {
+                    std::rethrow_exception(job->error);
+                }
+            }
+
+        private:
+            void work() {
+                inside_task = true;
+                unsigned long long seen{ 0 };
+                while (true) {
+                    std::shared_ptr<Job> job;
+                    {
+                        std::unique_lock<std::mutex> lock(lock_);
+                        wake_.wait(lock, [&] { return stop_ || (job_ && generation_ != seen); });
+                        if (stop_) {
+                            return;
+                        }
+                        seen = generation_;
+                        job = job_;
+                    }
+                    job->run();
+                    if (job->done.load() == job->n) {
+                        std::lock_guard<std::mutex> lock(lock_);
+                        finished_.notify_all();
+                    }
+                }
+            }
+
+            std::vector<std::thread> threads_;
+            std::mutex submit_lock_;
+            std::mutex lock_;
+            std::condition_variable wake_;
+            std::condition_variable finished_;
+            std::shared_ptr<Job> job_;
+            unsigned long long generation_{ 0 };
+            bool stop_ = false;
+        };
+
+        ThreadPool& pool() {
+            static ThreadPool instance;
+            return instance;
+        }
+    }
+
+    int thread_count() {
+        return pool().size();
+    }
+
+    void parallel_for(int n, const std::function<void(int)>& task) {
+        if (n <= 0) {
+            return;
+        }
+        if (n == 1 || inside_task || pool().size() == 1) {
+            for (int i = 0; i < n; i++) {
+                task(i);
+            }
+            return;
+        }
+        pool().run(n, task);
+    }
+
+    void run_serial(const std::function<void()>& fn) {
+        struct Restore {
+            bool was;
+            ~Restore() { inside_task = was; }
+        } restore{ inside_task };
+        inside_task = true;
+        fn();
+    }
+}
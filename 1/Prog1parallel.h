@@ -0,0 +1,22 @@
+#ifndef OOPPROG1_PROG1PARALLEL_H
+#define OOPPROG1_PROG1PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace Prog1 {
+    // below this many elements a single thread is faster than waking the pool
+    inline constexpr std::size_t parallel_min_nnz = 1 << 15;
+
+    // number of threads used by the parallel kernels (pool workers + the calling thread),
+    // hardware concurrency unless the PROG1_THREADS environment variable says otherwise
+    int thread_count();
+    // runs task(0) ... task(n - 1) on the shared thread pool and waits for all of them.
+    // The calling thread takes part; nested calls from inside a task run serially
+    void parallel_for(int n, const std::function<void(int)>& task);
+    // runs fn() with the parallel_for calls it makes kept on this thread, for background work that must
+    // not take the pool away from the kernels of the thread that waits for it
+    void run_serial(const std::function<void()>& fn);
+}
+
+#endif //OOPPROG1_PROG1PARALLEL_H
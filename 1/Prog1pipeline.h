@@ -0,0 +1,385 @@
+#ifndef OOPPROG1_PROG1PIPELINE_H
+#define OOPPROG1_PROG1PIPELINE_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Prog1.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1stats.h"
+
+namespace Prog1 {
+    // Row filters composed at compile time and run in one parallel sweep over the rows:
+    //
+    //     auto b = a | threshold(1e-3) | transform([](double v) { return 2 * v; }) | keep_top_k(8) | compact();
+    //
+    // Nothing runs before compact(). It allocates the row offsets of the result, counts the survivors, then grows
+    // the arena to the final number of elements (in place when it can, else with one copy of the offsets) and
+    // writes them. The stages see every row of the source in column order and may only drop elements or change
+    // values. Every row goes through the stages twice (once to count the survivors, once to write them), so the
+    // stages must give the same result both times. The source is referenced, not copied, until compact() returns.
+    //
+    // A row is only copied to a buffer when a row stage needs one: leading range stages narrow the source row
+    // in place, the element stages after them run while the row is read
+
+    // surviving elements of one row while a row stage runs: size elements in column order.
+    // scratch is per-thread storage the stage may use
+    template<class V, class I>
+    struct RowSegment {
+        I row;
+        I size;
+        I* col;
+        V* val;
+        std::vector<V>& scratch;
+    };
+
+    enum class StageKind { element, range, row };
+
+    // stages that look at one element at a time and keep it or not: keep(row, col, val) may change val
+    struct ElementStage {
+        static constexpr StageKind kind = StageKind::element;
+
+    protected:
+        // fn takes (row, col, value) or only the value
+        template<class F, class V, class I>
+        static auto call(const F& fn, I row, I col, V val) {
+            if constexpr (std::is_invocable_v<const F&, I, I, V>) {
+                return fn(row, col, val);
+            } else {
+                return fn(val);
+            }
+        }
+    };
+
+    // stages that keep one contiguous part of the row: range(row, col, val, size) gives its [first, last)
+    struct RangeStage {
+        static constexpr StageKind kind = StageKind::range;
+    };
+
+    // stages that need the whole row: apply(segment) shrinks segment.size keeping the column order
+    struct RowStage {
+        static constexpr StageKind kind = StageKind::row;
+    };
+
+    template<class S>
+    concept PipelineStage = std::derived_from<S, ElementStage> || std::derived_from<S, RangeStage>
+                            || std::derived_from<S, RowStage>;
+
+    // keeps the elements for which pred(row, col, value) (or pred(value)) is true
+    template<class Pred>
+    struct Filter : ElementStage {
+        Pred pred;
+
+        template<class V, class I>
+        bool keep(I row, I col, V& val) const {
+            return static_cast<bool>(call(pred, row, col, val));
+        }
+    };
+
+    // replaces every value with fn(row, col, value) (or fn(value))
+    template<class Fn>
+    struct Transform : ElementStage {
+        Fn fn;
+
+        template<class V, class I>
+        bool keep(I row, I col, V& val) const {
+            val = static_cast<V>(call(fn, row, col, val));
+            return true;
+        }
+    };
+
+    // keeps the elements with |value| >= limit
+    template<class T>
+    struct Threshold : ElementStage {
+        T limit;
+
+        template<class V, class I>
+        bool keep(I, I, V& val) const {
+            return (val < V{ 0 } ? -val : val) >= limit;
+        }
+    };
+
+    // keeps the k largest values of every row; of equal values at the cut the leftmost are kept
+    struct KeepTopK : RowStage {
+        std::size_t k;
+
+        template<class V, class I>
+        void apply(RowSegment<V, I>& seg) const {
+            if (static_cast<std::size_t>(seg.size) <= k) {
+                return;
+            }
+            I keep = static_cast<I>(k);
+            if (keep == 0) {
+                seg.size = 0;
+                return;
+            }
+            // the k-th largest value, and how many of the values equal to it fit in
+            seg.scratch.assign(seg.val, seg.val + seg.size);
+            std::nth_element(seg.scratch.begin(), seg.scratch.begin() + (keep - 1), seg.scratch.end(), std::greater<V>());
+            V cut = seg.scratch[keep - 1];
+            I equal_left = keep - static_cast<I>(std::count_if(seg.scratch.begin(), seg.scratch.begin() + (keep - 1),
+                                                               [&](V v) { return cut < v; }));
+            I n{ 0 };
+            for (I j = 0; j < seg.size; j++) {
+                bool take = cut < seg.val[j];
+                if (!take && seg.val[j] == cut && equal_left > 0) {
+                    take = true;
+                    equal_left--;
+                }
+                if (take) {
+                    seg.col[n] = seg.col[j];
+                    seg.val[n] = seg.val[j];
+                    n++;
+                }
+            }
+            seg.size = n;
+        }
+    };
+
+    // drops the elements to the left of the first row minimum (what specialfunc() does), found with the
+    // vectorized minimum of row_argmin
+    struct DropBeforeArgmin : RangeStage {
+        template<class V, class I>
+        std::pair<I, I> range(I, const I*, const V* val, I size) const {
+            return { static_cast<I>(first_min(val, static_cast<std::size_t>(size))), size };
+        }
+    };
+
+    template<class Pred>
+    Filter<Pred> filter(Pred pred) {
+        return { {}, std::move(pred) };
+    }
+    template<class Fn>
+    Transform<Fn> transform(Fn fn) {
+        return { {}, std::move(fn) };
+    }
+    template<class T>
+    Threshold<T> threshold(T limit) {
+        return { {}, limit };
+    }
+    inline KeepTopK keep_top_k(std::size_t k) {
+        return { {}, k };
+    }
+    inline DropBeforeArgmin drop_before_argmin() {
+        return {};
+    }
+
+    // ends a pipeline: pipeline | compact() runs it
+    struct Compact {};
+    inline Compact compact() {
+        return {};
+    }
+
+    template<class V, class I, PipelineStage... Stages>
+    class RowPipeline {
+    public:
+        RowPipeline(const BasicCSR<V, I>& source, std::tuple<Stages...> stages)
+            : source_(source), stages_(std::move(stages)) {}
+
+        template<PipelineStage S>
+        RowPipeline<V, I, Stages..., S> then(S stage) const {
+            return { source_, std::tuple_cat(stages_, std::make_tuple(std::move(stage))) };
+        }
+
+        // two phases over the same row partition: survivors per row, then the elements. A pipeline of range
+        // stages only keeps the start of every row from the first phase and copies in the second
+        BasicCSR<V, I> run() const {
+            PROG1_STATS_TIMER(filter);
+            const BasicCSR<V, I>& a = source_;
+            int parts = static_cast<std::size_t>(a.msize) < parallel_min_nnz ? 1 : thread_count();
+            std::vector<I> bounds = partition_rows(a, parts);
+            std::vector<I> part_size(parts + 1, 0);
+            BasicCSR<V, I> result;
+            result.allocate(a.row, 0);
+            result.col = a.col;
+            I* new_row = result.arr_row.data();
+            std::vector<I> keep_from(range_count == stage_count ? a.row : 0);
+
+            parallel_for(parts, [&](int p) {
+                RowBuffers buffers;
+                I total{ 0 };
+                for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                    if constexpr (range_count == stage_count) {
+                        I first = a.arr_row[i], last = a.arr_row[i + 1];
+                        narrow(i, first, last, std::make_index_sequence<range_count>());
+                        keep_from[i] = first;
+                        new_row[i + 1] = last - first;
+                    } else {
+                        new_row[i + 1] = process_row(i, buffers, nullptr, nullptr);
+                    }
+                    total += new_row[i + 1];
+                }
+                part_size[p + 1] = total;
+            });
+            for (int p = 0; p < parts; p++) {
+                part_size[p + 1] += part_size[p];
+            }
+            result.resize_nnz(part_size[parts]); // may move the arena
+            new_row = result.arr_row.data();
+
+            new_row[0] = 0;
+            parallel_for(parts, [&](int p) {
+                RowBuffers buffers;
+                I pos = part_size[p];
+                for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                    if constexpr (range_count == stage_count) {
+                        I count = new_row[i + 1];
+                        std::copy_n(a.arr_col.data() + keep_from[i], count, result.arr_col.data() + pos);
+                        std::copy_n(a.arr_val.data() + keep_from[i], count, result.arr_val.data() + pos);
+                        pos += count;
+                    } else {
+                        pos += process_row(i, buffers, result.arr_col.data() + pos, result.arr_val.data() + pos);
+                    }
+                    new_row[i + 1] = pos;
+                }
+            });
+            PROG1_STATS_ADD(elements_removed, a.msize - result.msize);
+            return result;
+        }
+
+    private:
+        static constexpr StageKind kinds[] = { Stages::kind..., StageKind::row };
+        static constexpr std::size_t stage_count = sizeof...(Stages);
+        // stages [0, range_count) narrow the source row, [range_count, fused_count) run while it is read,
+        // the rest run on the buffer
+        static constexpr std::size_t range_count = [] {
+            std::size_t n = 0;
+            while (kinds[n] == StageKind::range) {
+                n++;
+            }
+            return n;
+        }();
+        static constexpr std::size_t fused_count = [] {
+            std::size_t n = range_count;
+            while (kinds[n] == StageKind::element) {
+                n++;
+            }
+            return n;
+        }();
+
+        struct RowBuffers {
+            std::vector<I> col;
+            std::vector<V> val;
+            std::vector<V> scratch;
+        };
+
+        template<std::size_t... Is>
+        void narrow(I row, I& first, I& last, std::index_sequence<Is...>) const {
+            [[maybe_unused]] auto step = [&](const auto& stage) {
+                auto [from, to] = stage.range(row, source_.arr_col.data() + first, source_.arr_val.data() + first, last - first);
+                last = first + to;
+                first += from;
+            };
+            (step(std::get<Is>(stages_)), ...);
+        }
+
+        template<std::size_t... Is>
+        bool keep_fused(I row, I col, V& val, std::index_sequence<Is...>) const {
+            return (std::get<range_count + Is>(stages_).keep(row, col, val) && ...);
+        }
+
+        // reads row i through the range and fused stages into col / val (unless they are null),
+        // returns the number kept
+        I read_row(I i, I* col, V* val) const {
+            I first = source_.arr_row[i], last = source_.arr_row[i + 1];
+            narrow(i, first, last, std::make_index_sequence<range_count>());
+            if constexpr (fused_count == range_count) {
+                if (col) {
+                    std::copy_n(source_.arr_col.data() + first, last - first, col);
+                    std::copy_n(source_.arr_val.data() + first, last - first, val);
+                }
+                return last - first;
+            } else {
+                I n{ 0 };
+                for (I k = first; k < last; k++) {
+                    V v = source_.arr_val[k];
+                    if (keep_fused(i, source_.arr_col[k], v, std::make_index_sequence<fused_count - range_count>())) {
+                        if (col) {
+                            col[n] = source_.arr_col[k];
+                            val[n] = v;
+                        }
+                        n++;
+                    }
+                }
+                return n;
+            }
+        }
+
+        template<class S>
+        static void apply_stage(const S& stage, RowSegment<V, I>& seg) {
+            if constexpr (S::kind == StageKind::element) {
+                I n{ 0 };
+                for (I k = 0; k < seg.size; k++) {
+                    V v = seg.val[k];
+                    if (stage.keep(seg.row, seg.col[k], v)) {
+                        seg.col[n] = seg.col[k];
+                        seg.val[n] = v;
+                        n++;
+                    }
+                }
+                seg.size = n;
+            } else if constexpr (S::kind == StageKind::range) {
+                auto [from, to] = stage.range(seg.row, static_cast<const I*>(seg.col), static_cast<const V*>(seg.val), seg.size);
+                std::copy(seg.col + from, seg.col + to, seg.col);
+                std::copy(seg.val + from, seg.val + to, seg.val);
+                seg.size = to - from;
+            } else {
+                stage.apply(seg);
+            }
+        }
+
+        // row i through all stages; writes the survivors to out_col / out_val unless they are null
+        I process_row(I i, RowBuffers& buffers, I* out_col, V* out_val) const {
+            if constexpr (fused_count == stage_count) {
+                return read_row(i, out_col, out_val);
+            } else {
+                std::size_t length = static_cast<std::size_t>(source_.arr_row[i + 1] - source_.arr_row[i]);
+                if (buffers.col.size() < length) {
+                    buffers.col.resize(length);
+                    buffers.val.resize(length);
+                }
+                RowSegment<V, I> seg{ i, read_row(i, buffers.col.data(), buffers.val.data()),
+                                      buffers.col.data(), buffers.val.data(), buffers.scratch };
+                [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+                    (apply_stage(std::get<fused_count + Is>(stages_), seg), ...);
+                }(std::make_index_sequence<stage_count - fused_count>());
+                if (out_col) {
+                    std::copy_n(seg.col, seg.size, out_col);
+                    std::copy_n(seg.val, seg.size, out_val);
+                }
+                return seg.size;
+            }
+        }
+
+        const BasicCSR<V, I>& source_;
+        std::tuple<Stages...> stages_;
+    };
+
+    template<class V, class I, PipelineStage S>
+    RowPipeline<V, I, S> operator|(const BasicCSR<V, I>& source, S stage) {
+        return { source, std::make_tuple(std::move(stage)) };
+    }
+
+    template<class V, class I, class... Stages, PipelineStage S>
+    RowPipeline<V, I, Stages..., S> operator|(const RowPipeline<V, I, Stages...>& pipeline, S stage) {
+        return pipeline.then(std::move(stage));
+    }
+
+    template<class V, class I, class... Stages>
+    BasicCSR<V, I> operator|(const RowPipeline<V, I, Stages...>& pipeline, Compact) {
+        return pipeline.run();
+    }
+
+    template<class V, class I>
+    BasicCSR<V, I> operator|(const BasicCSR<V, I>& source, Compact) {
+        return RowPipeline<V, I>(source, {}).run();
+    }
+}
+
+#endif //OOPPROG1_PROG1PIPELINE_H
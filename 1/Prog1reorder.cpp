@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Prog1reorder.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+
+namespace Prog1 {
+    namespace {
+        // undirected graph of A + A^T without the diagonal: every row of A merged with the same row of A^T
+        // (both sorted by column), so a symmetric pair gives one neighbour, not two
+        template<class V, class I>
+        class Graph {
+        public:
+            explicit Graph(const BasicCSR<V, I>& a) : ptr_(static_cast<std::size_t>(a.row) + 1, 0) {
+                BasicCSR<V, I> t = transpose(a);
+                adj_.reserve(2 * static_cast<std::size_t>(a.msize));
+                for (I i = 0; i < a.row; i++) {
+                    const I* x = a.arr_col.data() + a.arr_row[i];
+                    const I* x_end = a.arr_col.data() + a.arr_row[i + 1];
+                    const I* y = t.arr_col.data() + t.arr_row[i];
+                    const I* y_end = t.arr_col.data() + t.arr_row[i + 1];
+                    while (x != x_end || y != y_end) {
+                        I v = y == y_end || (x != x_end && *x < *y) ? *x++ : *y++;
+                        if (v != i && (adj_.size() == ptr_[i] || adj_.back() != v)) {
+                            adj_.push_back(v);
+                        }
+                    }
+                    ptr_[i + 1] = adj_.size();
+                }
+            }
+
+            I size() const { return static_cast<I>(ptr_.size() - 1); }
+            I degree(I i) const { return static_cast<I>(ptr_[i + 1] - ptr_[i]); }
+
+            template<class F>
+            void for_neighbours(I i, F f) const {
+                for (std::size_t k = ptr_[i]; k < ptr_[i + 1]; k++) {
+                    f(adj_[k]);
+                }
+            }
+
+        private:
+            std::vector<std::size_t> ptr_;
+            std::vector<I> adj_;
+        };
+
+        // breadth-first search from root over its connected part: returns the number of levels and leaves
+        // the rows of the last level in last. seen[i] == stamp marks the rows reached by this search; the stamps
+        // are 64-bit, so they do not wrap however many searches run
+        template<class V, class I>
+        std::size_t bfs_levels(const Graph<V, I>& g, I root, std::vector<std::uint64_t>& seen, std::uint64_t stamp,
+                               std::vector<I>& queue, std::vector<I>& last) {
+            queue.clear();
+            queue.push_back(root);
+            seen[root] = stamp;
+            std::size_t levels{ 0 }, begin{ 0 };
+            while (begin < queue.size()) {
+                std::size_t end = queue.size();
+                last.assign(queue.begin() + begin, queue.begin() + end);
+                for (std::size_t q = begin; q < end; q++) {
+                    g.for_neighbours(queue[q], [&](I v) {
+                        if (seen[v] != stamp) {
+                            seen[v] = stamp;
+                            queue.push_back(v);
+                        }
+                    });
+                }
+                begin = end;
+                levels++;
+            }
+            return levels;
+        }
+
+        // George-Liu: restarts the search from a least-degree row of the last level while that adds levels
+        template<class V, class I>
+        I pseudo_peripheral(const Graph<V, I>& g, I start, std::vector<std::uint64_t>& seen, std::uint64_t& stamp) {
+            std::vector<I> queue, last;
+            I root = start;
+            std::size_t height = bfs_levels(g, root, seen, ++stamp, queue, last);
+            while (true) {
+                I candidate = *std::min_element(last.begin(), last.end(),
+                                                [&](I x, I y) { return g.degree(x) < g.degree(y); });
+                std::size_t h = bfs_levels(g, candidate, seen, ++stamp, queue, last);
+                if (h <= height) {
+                    return root;
+                }
+                root = candidate;
+                height = h;
+            }
+        }
+    }
+
+
+
+    template<class V, class I>
+    std::vector<I> reorder_permutation(const BasicCSR<V, I>& coord, Reordering how) {
+        if (coord.row != coord.col) {
+            throw std::runtime_error("Reordering needs a square matrix");
+        }
+        Graph<V, I> g(coord);
+        const std::size_t n = coord.row;
+        std::vector<I> by_degree(n);
+        for (std::size_t i = 0; i < n; i++) {
+            by_degree[i] = static_cast<I>(i);
+        }
+        std::stable_sort(by_degree.begin(), by_degree.end(), [&](I x, I y) { return g.degree(x) < g.degree(y); });
+        if (how == Reordering::degree) {
+            return by_degree;
+        }
+
+        // Cuthill-McKee order of every connected part, the parts taken from their least-degree row
+        std::vector<I> order;
+        order.reserve(n);
+        std::vector<char> numbered(n, 0);
+        std::vector<std::uint64_t> seen(n, 0);
+        std::uint64_t stamp{ 0 };
+        for (I s : by_degree) {
+            if (numbered[s]) {
+                continue;
+            }
+            I root = pseudo_peripheral(g, s, seen, stamp);
+            std::size_t head = order.size();
+            order.push_back(root);
+            numbered[root] = 1;
+            while (head < order.size()) {
+                I u = order[head++];
+                std::size_t first = order.size();
+                g.for_neighbours(u, [&](I v) {
+                    if (!numbered[v]) {
+                        numbered[v] = 1;
+                        order.push_back(v);
+                    }
+                });
+                std::stable_sort(order.begin() + first, order.end(), [&](I x, I y) { return g.degree(x) < g.degree(y); });
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    template<class V, class I>
+    BasicCSR<V, I> permute(const BasicCSR<V, I>& coord, const std::vector<I>& perm) {
+        const std::size_t n = coord.row;
+        if (coord.row != coord.col || perm.size() != n) {
+            throw std::runtime_error("Permutation does not fit the matrix");
+        }
+        std::vector<I> inverse(n);
+        std::vector<char> hit(n, 0);
+        for (std::size_t r = 0; r < n; r++) {
+            if (perm[r] < 0 || static_cast<std::size_t>(perm[r]) >= n || hit[perm[r]]) {
+                throw std::runtime_error("Not a permutation");
+            }
+            hit[perm[r]] = 1;
+            inverse[perm[r]] = static_cast<I>(r);
+        }
+
+        BasicCSR<V, I> result;
+        result.allocate(coord.row, coord.msize);
+        result.col = coord.col;
+        I* new_row = result.arr_row.data();
+        new_row[0] = 0;
+        for (std::size_t r = 0; r < n; r++) {
+            new_row[r + 1] = new_row[r] + (coord.arr_row[perm[r] + 1] - coord.arr_row[perm[r]]);
+        }
+
+        int parts = static_cast<std::size_t>(coord.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_offsets(new_row, coord.row, parts);
+        parallel_for(parts, [&](int p) {
+            for (I r = bounds[p]; r < bounds[p + 1]; r++) {
+                I pos = new_row[r];
+                for (I k = coord.arr_row[perm[r]]; k < coord.arr_row[perm[r] + 1]; k++, pos++) {
+                    result.arr_col[pos] = inverse[coord.arr_col[k]];
+                    result.arr_val[pos] = coord.arr_val[k];
+                }
+            }
+        });
+        sort_rows(result);
+        return result;
+    }
+
+    template<class V, class I>
+    void permute_vector(const std::vector<I>& perm, const V* x, V* out) {
+        for (std::size_t r = 0; r < perm.size(); r++) {
+            out[r] = x[perm[r]];
+        }
+    }
+
+    template<class V, class I>
+    void unpermute_vector(const std::vector<I>& perm, const V* x, V* out) {
+        for (std::size_t r = 0; r < perm.size(); r++) {
+            out[perm[r]] = x[r];
+        }
+    }
+
+    template<class V, class I>
+    std::uint64_t bandwidth(const BasicCSR<V, I>& coord) {
+        int parts = static_cast<std::size_t>(coord.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_rows(coord, parts);
+        std::vector<std::uint64_t> part_max(parts, 0);
+        parallel_for(parts, [&](int p) {
+            std::uint64_t m{ 0 };
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                for (I k = coord.arr_row[i]; k < coord.arr_row[i + 1]; k++) {
+                    I j = coord.arr_col[k];
+                    m = std::max<std::uint64_t>(m, i > j ? i - j : j - i);
+                }
+            }
+            part_max[p] = m;
+        });
+        return *std::max_element(part_max.begin(), part_max.end());
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template std::vector<I> reorder_permutation<V, I>(const BasicCSR<V, I>&, Reordering); \
+    template BasicCSR<V, I> permute<V, I>(const BasicCSR<V, I>&, const std::vector<I>&); \
+    template void permute_vector<V, I>(const std::vector<I>&, const V*, V*); \
+    template void unpermute_vector<V, I>(const std::vector<I>&, const V*, V*); \
+    template std::uint64_t bandwidth<V, I>(const BasicCSR<V, I>&);
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
@@ -0,0 +1,37 @@
+#ifndef OOPPROG1_PROG1REORDER_H
+#define OOPPROG1_PROG1REORDER_H
+
+#include <cstdint>
+#include <vector>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // symmetric reorderings of a square matrix for SpMV locality. A permutation perm lists the old row of every
+    // new row: new row r is old row perm[r], and column j becomes the new position of row j
+    enum class Reordering {
+        rcm,    // reverse Cuthill-McKee: breadth-first from a pseudo-peripheral row of every connected part,
+                // neighbours by increasing degree, then the order reversed. Narrows the band
+        degree  // rows by increasing degree (ties keep their order), cheaper, does not look at the band
+    };
+
+    // permutation from the structure of coord + coord^T (the values are not read); coord must be square
+    template<class V, class I>
+    std::vector<I> reorder_permutation(const BasicCSR<V, I>& coord, Reordering how = Reordering::rcm);
+
+    // P * A * P^T: rows and columns moved by perm, rows sorted by column again
+    template<class V, class I>
+    BasicCSR<V, I> permute(const BasicCSR<V, I>& coord, const std::vector<I>& perm);
+
+    // out[r] = x[perm[r]], x of the original numbering to the permuted one
+    template<class V, class I>
+    void permute_vector(const std::vector<I>& perm, const V* x, V* out);
+    // out[perm[r]] = x[r], back to the original numbering (y = A * x equals unpermute(P A P^T * permute(x)))
+    template<class V, class I>
+    void unpermute_vector(const std::vector<I>& perm, const V* x, V* out);
+
+    // max |i - j| over the stored elements (i, j)
+    template<class V, class I>
+    std::uint64_t bandwidth(const BasicCSR<V, I>& coord);
+}
+
+#endif //OOPPROG1_PROG1REORDER_H
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "Prog1sell.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1simd.h"
+
+
+namespace Prog1 {
+    namespace {
+        // out[r] = row r of the chunk times x, for r < C
+        template<class V, class I>
+        void chunk_scalar(const V* val, const I* col, I len, I c, const V* x, V* out) {
+            std::fill(out, out + c, V{ 0 });
+            for (I j = 0; j < len; j++) {
+                for (I r = 0; r < c; r++) {
+                    out[r] += val[j * c + r] * x[col[j * c + r]];
+                }
+            }
+        }
+
+#ifdef PROG1_HAVE_AVX2_PATH
+        // vector kernels: the chunk width equals the vector width (AVX2 - 8 lanes of 4 bytes or
+        // two halves of 4 doubles, AVX-512 - 16 lanes of 4 bytes or 8 doubles)
+        template<class I>
+        __attribute__((target("avx2")))
+        void chunk_avx2(const int* val, const I* col, I len, I, const int* x, int* out) {
+            __m256i acc = _mm256_setzero_si256();
+            for (I j = 0; j < len; j++) {
+                __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + j * 8));
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(val + j * 8));
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v, _mm256_i32gather_epi32(x, idx, 4)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), acc);
+        }
+
+        template<class I>
+        __attribute__((target("avx2,fma")))
+        void chunk_avx2(const float* val, const I* col, I len, I, const float* x, float* out) {
+            __m256 acc = _mm256_setzero_ps();
+            for (I j = 0; j < len; j++) {
+                __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + j * 8));
+                acc = _mm256_fmadd_ps(_mm256_loadu_ps(val + j * 8), _mm256_i32gather_ps(x, idx, 4), acc);
+            }
+            _mm256_storeu_ps(out, acc);
+        }
+
+        template<class I>
+        __attribute__((target("avx2,fma")))
+        void chunk_avx2(const double* val, const I* col, I len, I, const double* x, double* out) {
+            const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            __m256d lo = _mm256_setzero_pd(), hi = _mm256_setzero_pd();
+            for (I j = 0; j < len; j++) {
+                __m128i idx_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(col + j * 8));
+                __m128i idx_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(col + j * 8 + 4));
+                lo = _mm256_fmadd_pd(_mm256_loadu_pd(val + j * 8),
+                                     _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, idx_lo, all, 8), lo);
+                hi = _mm256_fmadd_pd(_mm256_loadu_pd(val + j * 8 + 4),
+                                     _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, idx_hi, all, 8), hi);
+            }
+            _mm256_storeu_pd(out, lo);
+            _mm256_storeu_pd(out + 4, hi);
+        }
+
+        template<class I>
+        __attribute__((target("avx512f")))
+        void chunk_avx512(const int* val, const I* col, I len, I, const int* x, int* out) {
+            __m512i acc = _mm512_setzero_si512();
+            for (I j = 0; j < len; j++) {
+                __m512i idx = _mm512_loadu_si512(col + j * 16);
+                __m512i v = _mm512_loadu_si512(val + j * 16);
+                acc = _mm512_add_epi32(acc, _mm512_mullo_epi32(v, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, idx, x, 4)));
+            }
+            _mm512_storeu_si512(out, acc);
+        }
+
+        template<class I>
+        __attribute__((target("avx512f")))
+        void chunk_avx512(const float* val, const I* col, I len, I, const float* x, float* out) {
+            __m512 acc = _mm512_setzero_ps();
+            for (I j = 0; j < len; j++) {
+                __m512i idx = _mm512_loadu_si512(col + j * 16);
+                acc = _mm512_fmadd_ps(_mm512_loadu_ps(val + j * 16), _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, idx, x, 4), acc);
+            }
+            _mm512_storeu_ps(out, acc);
+        }
+
+        template<class I>
+        __attribute__((target("avx512f")))
+        void chunk_avx512(const double* val, const I* col, I len, I, const double* x, double* out) {
+            __m512d acc = _mm512_setzero_pd();
+            for (I j = 0; j < len; j++) {
+                __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + j * 8));
+                acc = _mm512_fmadd_pd(_mm512_loadu_pd(val + j * 8), _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, x, 8), acc);
+            }
+            _mm512_storeu_pd(out, acc);
+        }
+#endif
+
+        template<class V, class I>
+        using ChunkKernel = void (*)(const V*, const I*, I, I, const V*, V*);
+
+        template<class V, class I>
+        ChunkKernel<V, I> pick_chunk_kernel(const SellCSigma<V, I>& sell) {
+#ifdef PROG1_HAVE_AVX2_PATH
+            constexpr bool vector_types = std::is_same_v<V, int> || std::is_same_v<V, float> || std::is_same_v<V, double>;
+            if constexpr (vector_types && sizeof(I) == 4) {
+                if (static_cast<std::uint64_t>(sell.col) <= std::numeric_limits<int>::max()) {
+                    if (cpu_has_avx512() && sell.chunk == static_cast<I>(64 / sizeof(V))) {
+                        return chunk_avx512<I>;
+                    }
+                    if (cpu_has_avx2() && sell.chunk == 8) {
+                        return chunk_avx2<I>;
+                    }
+                }
+            }
+#endif
+            return chunk_scalar<V, I>;
+        }
+
+        // chunk boundaries with about equal stored elements per part
+        template<class I>
+        std::vector<I> partition_chunks(const AlignedBuffer<I>& chunk_ptr, I chunks, int parts) {
+            std::vector<I> bounds(parts + 1);
+            bounds[0] = 0;
+            for (int p = 1; p < parts; p++) {
+                I target = static_cast<I>(static_cast<long double>(chunk_ptr[chunks]) * p / parts);
+                bounds[p] = static_cast<I>(std::lower_bound(chunk_ptr.begin(), chunk_ptr.begin() + chunks, target)
+                                           - chunk_ptr.begin());
+                bounds[p] = std::max(bounds[p], bounds[p - 1]);
+            }
+            bounds[parts] = chunks;
+            return bounds;
+        }
+    }
+
+
+
+    template<class V, class I>
+    SellCSigma<V, I> build_sell(const BasicCSR<V, I>& coord, I chunk, I sigma) {
+        if (chunk < 1 || sigma < 1) {
+            throw std::runtime_error("SELL chunk and sigma must be positive");
+        }
+        SellCSigma<V, I> sell;
+        sell.row = coord.row;
+        sell.col = coord.col;
+        sell.msize = coord.msize;
+        sell.chunk = chunk;
+        sell.sigma = sigma;
+        const std::size_t rows = coord.row;
+        const std::size_t chunks = (rows + chunk - 1) / chunk;
+        auto length = [&](I i) { return coord.arr_row[i + 1] - coord.arr_row[i]; };
+
+        // rows by length, longest first, inside every sigma window
+        sell.perm = AlignedBuffer<I>(rows);
+        std::iota(sell.perm.begin(), sell.perm.end(), I{ 0 });
+        std::size_t windows = (rows + sigma - 1) / sigma;
+        parallel_for(static_cast<int>(std::min<std::size_t>(windows, std::numeric_limits<int>::max())), [&](int w) {
+            I* first = sell.perm.data() + static_cast<std::size_t>(w) * sigma;
+            I* last = sell.perm.data() + std::min(rows, (static_cast<std::size_t>(w) + 1) * sigma);
+            std::stable_sort(first, last, [&](I a, I b) { return length(a) > length(b); });
+        });
+
+        sell.chunk_len = AlignedBuffer<I>(chunks);
+        sell.chunk_ptr = AlignedBuffer<I>(chunks + 1);
+        sell.chunk_ptr[0] = 0;
+        for (std::size_t c = 0; c < chunks; c++) {
+            // the first slot of a chunk holds its longest row unless a window border cuts the chunk
+            I width{ 0 };
+            for (std::size_t s = c * chunk; s < std::min(rows, (c + 1) * chunk); s++) {
+                width = std::max(width, length(sell.perm[s]));
+            }
+            sell.chunk_len[c] = width;
+            if (static_cast<std::uint64_t>(sell.chunk_ptr[c]) + static_cast<std::uint64_t>(width) * chunk
+                > static_cast<std::uint64_t>(std::numeric_limits<I>::max())) {
+                throw std::runtime_error("SELL storage does not fit the index type");
+            }
+            sell.chunk_ptr[c + 1] = sell.chunk_ptr[c] + width * chunk;
+        }
+
+        sell.arr_col = AlignedBuffer<I>(sell.chunk_ptr[chunks], true);
+        sell.arr_val = AlignedBuffer<V>(sell.chunk_ptr[chunks], true);
+        int parts = static_cast<std::size_t>(coord.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_chunks(sell.chunk_ptr, static_cast<I>(chunks), parts);
+        parallel_for(parts, [&](int p) {
+            for (I c = bounds[p]; c < bounds[p + 1]; c++) {
+                for (I r = 0; r < chunk && static_cast<std::size_t>(c) * chunk + r < rows; r++) {
+                    I i = sell.perm[c * chunk + r];
+                    I base = sell.chunk_ptr[c] + r;
+                    for (I k = coord.arr_row[i]; k < coord.arr_row[i + 1]; k++) {
+                        I j = k - coord.arr_row[i];
+                        sell.arr_col[base + j * chunk] = coord.arr_col[k];
+                        sell.arr_val[base + j * chunk] = coord.arr_val[k];
+                    }
+                }
+            }
+        });
+        return sell;
+    }
+
+    template<class V, class I>
+    void spmv(const SellCSigma<V, I>& sell, const V* x, V* y) {
+        ChunkKernel<V, I> kernel = pick_chunk_kernel(sell);
+        const I chunks = sell.chunks();
+        const std::size_t rows = sell.row;
+        int parts = sell.arr_val.size() < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_chunks(sell.chunk_ptr, chunks, parts);
+        parallel_for(parts, [&](int p) {
+            std::vector<V> out(sell.chunk);
+            for (I c = bounds[p]; c < bounds[p + 1]; c++) {
+                I start = sell.chunk_ptr[c];
+                kernel(sell.arr_val.data() + start, sell.arr_col.data() + start, sell.chunk_len[c], sell.chunk, x, out.data());
+                for (I r = 0; r < sell.chunk && static_cast<std::size_t>(c) * sell.chunk + r < rows; r++) {
+                    y[sell.perm[c * sell.chunk + r]] = out[r];
+                }
+            }
+        });
+    }
+
+
+
+    template<class V, class I>
+    SpmvFormat choose_format(const BasicCSR<V, I>& coord, double max_cv, double min_mean) {
+        if (coord.row == 0) {
+            return SpmvFormat::csr;
+        }
+        double mean = static_cast<double>(coord.msize) / coord.row;
+        double sq{ 0 };
+        for (I i = 0; i < coord.row; i++) {
+            double d = static_cast<double>(coord.arr_row[i + 1] - coord.arr_row[i]) - mean;
+            sq += d * d;
+        }
+        double cv = mean > 0 ? std::sqrt(sq / coord.row) / mean : 0.0;
+        return mean >= min_mean && cv <= max_cv ? SpmvFormat::sell : SpmvFormat::csr;
+    }
+
+    template<class V, class I>
+    AutoSpmv<V, I>::AutoSpmv(BasicCSR<V, I> coord) : csr_(std::move(coord)), format_(choose_format(csr_)) {
+        if (format_ == SpmvFormat::sell) {
+            sell_ = build_sell(csr_);
+        }
+    }
+
+    template<class V, class I>
+    void AutoSpmv<V, I>::apply(const V* x, V* y) const {
+        if (format_ == SpmvFormat::sell) {
+            spmv(sell_, x, y);
+        } else {
+            spmv(csr_, x, y);
+        }
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template SellCSigma<V, I> build_sell<V, I>(const BasicCSR<V, I>&, I, I); \
+    template void spmv<V, I>(const SellCSigma<V, I>&, const V*, V*); \
+    template SpmvFormat choose_format<V, I>(const BasicCSR<V, I>&, double, double); \
+    template class AutoSpmv<V, I>;
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
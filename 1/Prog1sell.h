@@ -0,0 +1,60 @@
+#ifndef OOPPROG1_PROG1SELL_H
+#define OOPPROG1_PROG1SELL_H
+
+#include "Prog1.h"
+
+namespace Prog1 {
+    // SELL-C-sigma: rows are sorted by length (longest first) inside windows of sigma rows,
+    // cut into chunks of C rows and every chunk is padded to its longest row. Inside a chunk the
+    // elements are stored column-major, so one vector step handles the same position of C rows
+    template<class V, class I>
+    struct SellCSigma {
+        I row{ 0 }, col{ 0 }, msize{ 0 };   // msize - real elements, without the padding
+        I chunk{ 0 }, sigma{ 0 };            // C and sigma
+        AlignedBuffer<I> perm;               // perm[s] - row stored in slot s (row elements)
+        AlignedBuffer<I> chunk_ptr;          // start of chunk c in arr_col/arr_val (chunks + 1 elements)
+        AlignedBuffer<I> chunk_len;          // width of chunk c
+        AlignedBuffer<I> arr_col;            // element j of slot r of chunk c is at chunk_ptr[c] + j * C + r,
+        AlignedBuffer<V> arr_val;            // padding has column 0 and value 0
+
+        I chunks() const { return static_cast<I>(chunk_len.size()); }
+        // stored elements per real one (1 means no padding)
+        double fill_ratio() const { return msize == 0 ? 1.0 : static_cast<double>(arr_val.size()) / msize; }
+    };
+
+    // chunk = 8 suits AVX2 (and AVX-512 for double), chunk = 16 suits AVX-512 for 4-byte values
+    template<class V, class I>
+    SellCSigma<V, I> build_sell(const BasicCSR<V, I>& coord, I chunk = 8, I sigma = 256);
+
+    // y = A * x
+    template<class V, class I>
+    void spmv(const SellCSigma<V, I>& sell, const V* x, V* y);
+
+
+
+    enum class SpmvFormat { csr, sell };
+
+    // SELL pays off when the rows have similar lengths: picks it when the coefficient of variation
+    // of the row lengths (from arr_row) is at most max_cv and the rows are not too short
+    template<class V, class I>
+    SpmvFormat choose_format(const BasicCSR<V, I>& coord, double max_cv = 0.5, double min_mean = 4.0);
+
+    // matrix prepared for repeated SpMV in the format choose_format() picked
+    template<class V, class I>
+    class AutoSpmv {
+    public:
+        explicit AutoSpmv(BasicCSR<V, I> coord);
+
+        SpmvFormat format() const { return format_; }
+        const BasicCSR<V, I>& csr() const { return csr_; }
+        // y = A * x
+        void apply(const V* x, V* y) const;
+
+    private:
+        BasicCSR<V, I> csr_;
+        SellCSigma<V, I> sell_;
+        SpmvFormat format_;
+    };
+}
+
+#endif //OOPPROG1_PROG1SELL_H
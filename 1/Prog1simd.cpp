@@ -0,0 +1,32 @@
+#include <atomic>
+#include "Prog1simd.h"
+
+namespace Prog1 {
+    namespace {
+        std::atomic<bool> vector_kernels{ true };
+    }
+
+
+
+    bool cpu_has_avx2() {
+#ifdef PROG1_HAVE_AVX2_PATH
+        static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return has && vector_kernels.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    bool cpu_has_avx512() {
+#ifdef PROG1_HAVE_AVX2_PATH
+        static const bool has = __builtin_cpu_supports("avx512f");
+        return has && vector_kernels.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    void set_vector_kernels(bool enabled) {
+        vector_kernels.store(enabled, std::memory_order_relaxed);
+    }
+}
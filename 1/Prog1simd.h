@@ -0,0 +1,21 @@
+#ifndef OOPPROG1_PROG1SIMD_H
+#define OOPPROG1_PROG1SIMD_H
+
+// vector kernel support shared by the .cpp files that have AVX2 / AVX-512 paths. The kernels are compiled
+// with target attributes, so the library still runs on CPUs without them: every caller checks at run time
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PROG1_HAVE_AVX2_PATH 1
+#include <immintrin.h>
+#endif
+
+namespace Prog1 {
+    // AVX2 and FMA can be used: the CPU has them and the vector kernels are switched on
+    bool cpu_has_avx2();
+    // AVX-512F can be used
+    bool cpu_has_avx512();
+    // switches the vector kernels off (false) or back on, e.g. to compare them with the scalar ones.
+    // Kernels already running keep the path they picked
+    void set_vector_kernels(bool enabled);
+}
+
+#endif //OOPPROG1_PROG1SIMD_H
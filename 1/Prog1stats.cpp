@@ -0,0 +1,74 @@
+#include <cstdio>
+#include "Prog1stats.h"
+
+namespace Prog1 {
+    namespace {
+        const char* phase_names[] = { "parse", "build", "filter", "output" };
+        const char* counter_names[] = { "elements_built", "duplicates_merged", "elements_removed", "bytes_allocated",
+                                        "output_bytes" };
+
+        // innermost running timer of this thread
+        thread_local ScopedTimer* current_timer = nullptr;
+    }
+
+    double CSRStats::milliseconds(Phase phase) const {
+        return static_cast<double>(phase_ns_[static_cast<int>(phase)].load(std::memory_order_relaxed)) * 1e-6;
+    }
+
+    std::uint64_t CSRStats::count(Counter counter) const {
+        return counters_[static_cast<int>(counter)].load(std::memory_order_relaxed);
+    }
+
+    void CSRStats::reset() {
+        for (auto& t : phase_ns_) {
+            t.store(0, std::memory_order_relaxed);
+        }
+        for (auto& c : counters_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::string CSRStats::to_json() const {
+        std::string json = std::string("{\"enabled\": ") + (enabled ? "true" : "false") + ", \"phases_ms\": {";
+        char number[64];
+        for (int p = 0; p < phase_count; p++) {
+            std::snprintf(number, sizeof(number), "%.3f", milliseconds(static_cast<Phase>(p)));
+            json += std::string(p ? ", \"" : "\"") + phase_names[p] + "\": " + number;
+        }
+        json += "}, \"counters\": {";
+        for (int c = 0; c < counter_count; c++) {
+            json += std::string(c ? ", \"" : "\"") + counter_names[c] + "\": "
+                    + std::to_string(count(static_cast<Counter>(c)));
+        }
+        return json + "}}";
+    }
+
+    CSRStats& stats() {
+        static CSRStats instance;
+        return instance;
+    }
+
+    ScopedTimer::ScopedTimer(Phase phase)
+        : phase_(phase), outer_(current_timer), start_(std::chrono::steady_clock::now()) {
+        active_ = !outer_ || outer_->phase_ != phase;
+        if (!active_) {
+            return;
+        }
+        if (outer_) {
+            stats().add_time(outer_->phase_, start_ - outer_->start_);
+        }
+        current_timer = this;
+    }
+
+    ScopedTimer::~ScopedTimer() {
+        if (!active_) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        stats().add_time(phase_, now - start_);
+        if (outer_) {
+            outer_->start_ = now; // the outer phase goes on from here
+        }
+        current_timer = outer_;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef OOPPROG1_PROG1STATS_H
+#define OOPPROG1_PROG1STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Prog1 {
+    // phases of input -> specialfunc -> output. A phase timed inside another one pauses it,
+    // so every phase gets its own time only. That holds per thread: timers of different threads add up
+    // side by side, so with work in the background (the read-ahead of RowBlockReader parses and builds
+    // the next block during the caller's filter) the phases may sum to more than the wall time
+    enum class Phase { parse, build, filter, output };
+    // bytes_allocated counts every matrix array and arena allocation, not what is still alive
+    enum class Counter { elements_built, duplicates_merged, elements_removed, bytes_allocated, output_bytes };
+
+    // process-wide timers and counters. They are filled in only when the library is built with PROG1_STATS
+    // (the PROG1_STATS_* probes below compile to nothing otherwise); safe to update from several threads
+    class CSRStats {
+    public:
+#ifdef PROG1_STATS
+        static constexpr bool enabled = true;
+#else
+        static constexpr bool enabled = false;
+#endif
+
+        void add_time(Phase phase, std::chrono::steady_clock::duration time) {
+            phase_ns_[static_cast<int>(phase)].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+                                                          std::memory_order_relaxed);
+        }
+        void add(Counter counter, std::uint64_t n) {
+            counters_[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed);
+        }
+
+        double milliseconds(Phase phase) const;
+        std::uint64_t count(Counter counter) const;
+        void reset();
+        // {"enabled": ..., "phases_ms": {"parse": ..., ...}, "counters": {"elements_built": ..., ...}}
+        std::string to_json() const;
+
+    private:
+        static constexpr int phase_count = 4;
+        static constexpr int counter_count = 5;
+
+        std::atomic<std::int64_t> phase_ns_[phase_count]{};
+        std::atomic<std::uint64_t> counters_[counter_count]{};
+    };
+
+    CSRStats& stats();
+
+    // adds the time from its construction to its destruction to phase. Inside a timer of the same phase
+    // (on the same thread) it does nothing, inside another phase it pauses that one
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Phase phase);
+        ~ScopedTimer();
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Phase phase_;
+        bool active_;
+        ScopedTimer* outer_;
+        std::chrono::steady_clock::time_point start_;
+    };
+}
+
+#ifdef PROG1_STATS
+#define PROG1_STATS_CONCAT_(a, b) a##b
+#define PROG1_STATS_CONCAT(a, b) PROG1_STATS_CONCAT_(a, b)
+// times the rest of the enclosing scope as Phase::phase
+#define PROG1_STATS_TIMER(phase) ::Prog1::ScopedTimer PROG1_STATS_CONCAT(prog1_timer_, __LINE__)(::Prog1::Phase::phase)
+// adds n to Counter::counter; n is not evaluated without PROG1_STATS
+#define PROG1_STATS_ADD(counter, n) ::Prog1::stats().add(::Prog1::Counter::counter, static_cast<std::uint64_t>(n))
+#else
+#define PROG1_STATS_TIMER(phase) static_cast<void>(0)
+#define PROG1_STATS_ADD(counter, n) static_cast<void>(0)
+#endif
+
+#endif //OOPPROG1_PROG1STATS_H
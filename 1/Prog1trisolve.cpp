@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "Prog1trisolve.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+
+namespace Prog1 {
+    namespace {
+        // a level with less work than this (rows + elements) is solved by the calling thread: waking the pool
+        // for every level would cost more than the level itself. Lower than parallel_min_nnz, since a
+        // level is only a slice of the matrix
+        const std::size_t parallel_min_level = parallel_min_nnz / 4;
+
+        // substitution for the rows rows[0 .. count); the rows they depend on are already solved
+        template<class V, class I>
+        void solve_rows(const BasicCSR<V, I>& coord, Triangle uplo, const I* rows, I count, const V* b, V* x) {
+            for (I q = 0; q < count; q++) {
+                I i = rows[q];
+                I begin = coord.arr_row[i], end = coord.arr_row[i + 1];
+                // the diagonal ends a row of L and starts a row of U
+                I diag = uplo == Triangle::lower ? end - 1 : begin;
+                I from = uplo == Triangle::lower ? begin : begin + 1;
+                I to = uplo == Triangle::lower ? end - 1 : end;
+                V sum = b[i];
+                for (I k = from; k < to; k++) {
+                    sum -= coord.arr_val[k] * x[coord.arr_col[k]];
+                }
+                if (coord.arr_val[diag] == V{ 0 }) {
+                    throw std::runtime_error("Zero on the diagonal");
+                }
+                x[i] = sum / coord.arr_val[diag];
+            }
+        }
+    }
+
+
+
+    template<class V, class I>
+    LevelSets<I> level_sets(const BasicCSR<V, I>& coord, Triangle uplo) {
+        if (coord.row != coord.col) {
+            throw std::runtime_error("Triangular solve needs a square matrix");
+        }
+        const std::size_t n = coord.row;
+        // rows of L depend on earlier rows, rows of U on later ones, so one pass in that order is enough
+        std::vector<I> level(n);
+        I depth{ 0 };
+        for (std::size_t step = 0; step < n; step++) {
+            I i = static_cast<I>(uplo == Triangle::lower ? step : n - 1 - step);
+            I begin = coord.arr_row[i], end = coord.arr_row[i + 1];
+            // columns are sorted, so the diagonal in place means no element on the wrong side
+            if (begin == end || coord.arr_col[uplo == Triangle::lower ? end - 1 : begin] != i) {
+                throw std::runtime_error(uplo == Triangle::lower ? "Not a lower triangular matrix with a stored diagonal"
+                                                                 : "Not an upper triangular matrix with a stored diagonal");
+            }
+            I from = uplo == Triangle::lower ? begin : begin + 1;
+            I to = uplo == Triangle::lower ? end - 1 : end;
+            I l{ 0 };
+            for (I k = from; k < to; k++) {
+                l = std::max<I>(l, level[coord.arr_col[k]] + 1);
+            }
+            level[i] = l;
+            depth = std::max<I>(depth, l + 1);
+        }
+
+        // counting sort of the rows by level
+        LevelSets<I> sets;
+        sets.uplo = uplo;
+        sets.row = coord.row;
+        sets.msize = coord.msize;
+        sets.level_ptr.assign(static_cast<std::size_t>(depth) + 1, 0);
+        for (std::size_t i = 0; i < n; i++) {
+            sets.level_ptr[level[i] + 1]++;
+        }
+        for (I l = 0; l < depth; l++) {
+            sets.level_ptr[l + 1] += sets.level_ptr[l];
+        }
+        std::vector<I> cursor(sets.level_ptr.begin(), sets.level_ptr.end() - 1);
+        sets.order.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            sets.order[cursor[level[i]]++] = static_cast<I>(i);
+        }
+        sets.work.resize(n + 1);
+        sets.work[0] = 0;
+        for (std::size_t k = 0; k < n; k++) {
+            I i = sets.order[k];
+            sets.work[k + 1] = sets.work[k] + (coord.arr_row[i + 1] - coord.arr_row[i]);
+        }
+        return sets;
+    }
+
+    template<class V, class I>
+    void triangular_solve(const BasicCSR<V, I>& coord, const LevelSets<I>& levels, const V* b, V* x) {
+        if (levels.row != coord.row || levels.msize != coord.msize) {
+            throw std::runtime_error("Level sets of another matrix");
+        }
+        auto level_work = [&](std::size_t l) {
+            I first = levels.level_ptr[l], last = levels.level_ptr[l + 1];
+            return static_cast<std::size_t>(last - first) + (levels.work[last] - levels.work[first]);
+        };
+        bool any_wide = false;
+        for (std::size_t l = 0; l < levels.levels() && !any_wide; l++) {
+            any_wide = level_work(l) >= parallel_min_level;
+        }
+        if (!any_wide || thread_count() == 1) {
+            // nothing to share out: plain substitution in row order, which reads the matrix front to back
+            // instead of jumping between the rows of a level
+            const std::size_t n = coord.row;
+            for (std::size_t step = 0; step < n; step++) {
+                I i = static_cast<I>(levels.uplo == Triangle::lower ? step : n - 1 - step);
+                solve_rows(coord, levels.uplo, &i, I{ 1 }, b, x);
+            }
+            return;
+        }
+
+        // parallel_for returns when all its tasks are done: the barrier between two levels
+        for (std::size_t l = 0; l < levels.levels(); l++) {
+            I first = levels.level_ptr[l], count = levels.level_ptr[l + 1] - first;
+            int parts = level_work(l) < parallel_min_level ? 1 : thread_count();
+            if (parts == 1) {
+                solve_rows(coord, levels.uplo, levels.order.data() + first, count, b, x);
+                continue;
+            }
+            std::vector<I> bounds = partition_offsets(levels.work.data() + first, count, parts);
+            parallel_for(parts, [&](int p) {
+                solve_rows(coord, levels.uplo, levels.order.data() + first + bounds[p], bounds[p + 1] - bounds[p], b, x);
+            });
+        }
+    }
+
+    template<class V, class I>
+    void triangular_solve(const BasicCSR<V, I>& coord, Triangle uplo, const V* b, V* x) {
+        triangular_solve(coord, level_sets(coord, uplo), b, x);
+    }
+
+
+
+    template<class V, class I>
+    const LevelSets<I>& TriangularSolver<V, I>::levels() const {
+        std::call_once(analysed_, [this] { levels_ = level_sets(matrix_, uplo_); });
+        return levels_;
+    }
+
+    template<class V, class I>
+    void TriangularSolver<V, I>::solve(const V* b, V* x) const {
+        triangular_solve(matrix_, levels(), b, x);
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template LevelSets<I> level_sets<V, I>(const BasicCSR<V, I>&, Triangle); \
+    template void triangular_solve<V, I>(const BasicCSR<V, I>&, const LevelSets<I>&, const V*, V*); \
+    template void triangular_solve<V, I>(const BasicCSR<V, I>&, Triangle, const V*, V*); \
+    template class TriangularSolver<V, I>;
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
@@ -0,0 +1,64 @@
+#ifndef OOPPROG1_PROG1TRISOLVE_H
+#define OOPPROG1_PROG1TRISOLVE_H
+
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // triangular matrices for forward (lower) and backward (upper) substitution: every row keeps its diagonal
+    // element and, lower, only columns to the left of it, upper, only columns to the right
+    enum class Triangle { lower, upper };
+
+    // rows grouped by dependency level: a row of level l depends only on rows of levels below l, so the rows of
+    // one level can be solved at the same time. Depends on the structure alone (not on the values)
+    template<class I>
+    struct LevelSets {
+        Triangle uplo{ Triangle::lower };
+        I row{ 0 }, msize{ 0 };     // size of the analysed matrix
+        std::vector<I> level_ptr;   // rows of level l are order[level_ptr[l] .. level_ptr[l + 1])
+        std::vector<I> order;       // rows level after level, increasing inside a level
+        std::vector<I> work;        // work[k] - elements of the rows order[0 .. k), to split a level evenly
+
+        std::size_t levels() const { return level_ptr.empty() ? 0 : level_ptr.size() - 1; }
+    };
+
+    // analysis: level of row i = 1 + the highest level of the rows it refers to. Throws unless coord is square
+    // and uplo triangular with every diagonal element stored
+    template<class V, class I>
+    LevelSets<I> level_sets(const BasicCSR<V, I>& coord, Triangle uplo);
+
+    // solves L * x = b or U * x = b, level after level; the rows of a wide level are shared out between the
+    // threads, narrow levels run on the calling thread. levels must come from a matrix of the same structure.
+    // x may be b. Integer values divide with truncation; throws on a zero diagonal element
+    template<class V, class I>
+    void triangular_solve(const BasicCSR<V, I>& coord, const LevelSets<I>& levels, const V* b, V* x);
+    // analysis and solve at once
+    template<class V, class I>
+    void triangular_solve(const BasicCSR<V, I>& coord, Triangle uplo, const V* b, V* x);
+
+    // triangular matrix together with its level sets, found on the first solve and kept, so that repeated
+    // solves cost only the substitution. The values may be changed between solves, the structure may not
+    template<class V, class I>
+    class TriangularSolver {
+    public:
+        TriangularSolver(BasicCSR<V, I> coord, Triangle uplo) : matrix_(std::move(coord)), uplo_(uplo) {}
+
+        const BasicCSR<V, I>& matrix() const { return matrix_; }
+        // values of the matrix, to be refilled for the next solve
+        V* values() { return matrix_.arr_val.data(); }
+        const LevelSets<I>& levels() const;
+
+        // x has matrix().row elements and may be b
+        void solve(const V* b, V* x) const;
+
+    private:
+        BasicCSR<V, I> matrix_;
+        Triangle uplo_;
+        mutable LevelSets<I> levels_;
+        mutable std::once_flag analysed_;
+    };
+}
+
+#endif //OOPPROG1_PROG1TRISOLVE_H
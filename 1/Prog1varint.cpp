@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Prog1varint.h"
+#include "Prog1kernels.h"
+#include "Prog1parallel.h"
+#include "Prog1simd.h"
+
+
+namespace Prog1 {
+    namespace {
+        std::size_t varint_size(std::uint64_t v) {
+            std::size_t n = 1;
+            while (v >= 0x80) {
+                v >>= 7;
+                n++;
+            }
+            return n;
+        }
+
+        std::uint8_t* put_varint(std::uint8_t* p, std::uint64_t v) {
+            while (v >= 0x80) {
+                *p++ = static_cast<std::uint8_t>(v | 0x80);
+                v >>= 7;
+            }
+            *p++ = static_cast<std::uint8_t>(v);
+            return p;
+        }
+
+        // the rest of a varint whose first byte (high bit set) is already read
+        std::uint64_t get_varint_tail(const std::uint8_t*& p, std::uint64_t first) {
+            std::uint64_t v = first & 0x7F;
+            unsigned shift = 7;
+            std::uint8_t b;
+            do {
+                b = *p++;
+                v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            return v;
+        }
+
+        std::uint64_t get_varint(const std::uint8_t*& p) {
+            std::uint64_t v = *p++;
+            return v & 0x80 ? get_varint_tail(p, v) : v;
+        }
+
+        // the first column of a row, as a signed distance from the row index (zigzag: 0, -1, 1, -2, ...),
+        // so that it takes one byte around the diagonal of a banded matrix
+        template<class I>
+        std::uint64_t first_code(I i, I j) {
+            std::int64_t d = static_cast<std::int64_t>(j) - static_cast<std::int64_t>(i);
+            return (static_cast<std::uint64_t>(d) << 1) ^ static_cast<std::uint64_t>(d >> 63);
+        }
+
+        template<class I>
+        std::uint64_t first_column(I i, std::uint64_t code) {
+            std::int64_t d = static_cast<std::int64_t>(code >> 1) ^ -static_cast<std::int64_t>(code & 1);
+            return static_cast<std::uint64_t>(static_cast<std::int64_t>(i) + d);
+        }
+
+        // the rest of a row after its first element (column j) whose gaps all fit one byte: no continuation bits to test
+        template<class V, class I>
+        V dot_bytes_scalar(const V* val, const std::uint8_t* gaps, I count, const V* x, std::uint64_t j) {
+            V sum{ 0 };
+            for (I k = 0; k < count; k++) {
+                j += gaps[k];
+                sum += val[k] * x[j];
+            }
+            return sum;
+        }
+
+#ifdef PROG1_HAVE_AVX2_PATH
+        // columns of the next 8 one-byte gaps: inclusive prefix sum of the gaps plus the previous column
+        // (in every lane of last, which gets the new last column)
+        __attribute__((target("avx2")))
+        inline __m256i next_columns(const std::uint8_t* gaps, __m256i& last) {
+            __m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(gaps)));
+            g = _mm256_add_epi32(g, _mm256_slli_si256(g, 4));
+            g = _mm256_add_epi32(g, _mm256_slli_si256(g, 8));
+            // the sum of the low half goes to every lane of the high one
+            __m256i low_total = _mm256_shuffle_epi32(g, _MM_SHUFFLE(3, 3, 3, 3));
+            g = _mm256_add_epi32(g, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+            g = _mm256_add_epi32(g, last);
+            last = _mm256_permutevar8x32_epi32(g, _mm256_set1_epi32(7));
+            return g;
+        }
+
+        __attribute__((target("avx2")))
+        inline std::uint64_t last_column(__m256i last) {
+            return static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm256_castsi256_si128(last)));
+        }
+
+        // the tail of a one-byte row after k elements, j is the column of element k - 1
+        template<class V, class I>
+        V dot_bytes_tail(const V* val, const std::uint8_t* gaps, I k, I count, const V* x, std::uint64_t j) {
+            V sum{ 0 };
+            for (; k < count; k++) {
+                j += gaps[k];
+                sum += val[k] * x[j];
+            }
+            return sum;
+        }
+
+        template<class I>
+        __attribute__((target("avx2")))
+        int dot_bytes_avx2(const int* val, const std::uint8_t* gaps, I count, const int* x, std::uint64_t j) {
+            const __m256i all = _mm256_set1_epi32(-1);
+            __m256i acc = _mm256_setzero_si256(), last = _mm256_set1_epi32(static_cast<int>(j));
+            I k = 0;
+            for (; k + 8 <= count; k += 8) {
+                __m256i cols = next_columns(gaps + k, last);
+                __m256i xs = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), x, cols, all, 4);
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(val + k)), xs));
+            }
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtsi128_si32(s) + dot_bytes_tail(val, gaps, k, count, x, last_column(last));
+        }
+
+        template<class I>
+        __attribute__((target("avx2,fma")))
+        float dot_bytes_avx2(const float* val, const std::uint8_t* gaps, I count, const float* x, std::uint64_t j) {
+            const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            __m256 acc = _mm256_setzero_ps();
+            __m256i last = _mm256_set1_epi32(static_cast<int>(j));
+            I k = 0;
+            for (; k + 8 <= count; k += 8) {
+                __m256i cols = next_columns(gaps + k, last);
+                __m256 xs = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), x, cols, all, 4);
+                acc = _mm256_fmadd_ps(_mm256_loadu_ps(val + k), xs, acc);
+            }
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+            return _mm_cvtss_f32(s) + dot_bytes_tail(val, gaps, k, count, x, last_column(last));
+        }
+
+        template<class I>
+        __attribute__((target("avx2,fma")))
+        double dot_bytes_avx2(const double* val, const std::uint8_t* gaps, I count, const double* x, std::uint64_t j) {
+            const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            __m256d acc = _mm256_setzero_pd();
+            __m256i last = _mm256_set1_epi32(static_cast<int>(j));
+            I k = 0;
+            for (; k + 8 <= count; k += 8) {
+                __m256i cols = next_columns(gaps + k, last);
+                __m256d lo = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, _mm256_castsi256_si128(cols), all, 8);
+                __m256d hi = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, _mm256_extracti128_si256(cols, 1), all, 8);
+                acc = _mm256_fmadd_pd(_mm256_loadu_pd(val + k), lo, acc);
+                acc = _mm256_fmadd_pd(_mm256_loadu_pd(val + k + 4), hi, acc);
+            }
+            __m128d s = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+            s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+            return _mm_cvtsd_f64(s) + dot_bytes_tail(val, gaps, k, count, x, last_column(last));
+        }
+#endif
+
+        template<class V, class I>
+        using DotBytes = V (*)(const V*, const std::uint8_t*, I, const V*, std::uint64_t);
+
+        template<class V, class I>
+        DotBytes<V, I> pick_dot_bytes(const VarintCSR<V, I>& a) {
+#ifdef PROG1_HAVE_AVX2_PATH
+            // the gathers take 32-bit signed lane indices
+            constexpr bool vector_types = std::is_same_v<V, int> || std::is_same_v<V, float> || std::is_same_v<V, double>;
+            if constexpr (vector_types) {
+                if (cpu_has_avx2() && static_cast<std::uint64_t>(a.col) <= std::numeric_limits<int>::max()) {
+                    return dot_bytes_avx2<I>;
+                }
+            }
+#endif
+            return dot_bytes_scalar<V, I>;
+        }
+
+        template<class V, class I>
+        V dot_row(const VarintCSR<V, I>& a, I i, const V* x, DotBytes<V, I> dot_bytes) {
+            const V* val = a.arr_val.data() + a.arr_row[i];
+            I count = a.arr_row[i + 1] - a.arr_row[i];
+            if (count == 0) {
+                return V{ 0 };
+            }
+            const std::uint8_t* p = a.arr_idx.data() + a.idx_row[i];
+            const std::uint8_t* end = a.arr_idx.data() + a.idx_row[i + 1];
+            std::uint64_t j = first_column(i, get_varint(p));
+            V sum = val[0] * x[j];
+            // the first column has its own encoding, the fast path only looks at the gaps after it
+            if (static_cast<std::uint64_t>(end - p) == static_cast<std::uint64_t>(count - 1)) {
+                return sum + dot_bytes(val + 1, p, count - 1, x, j);
+            }
+            for (I k = 1; k < count; k++) {
+                std::uint64_t gap = *p++;
+                if (gap & 0x80) {
+                    gap = get_varint_tail(p, gap);
+                }
+                j += gap;
+                sum += val[k] * x[j];
+            }
+            return sum;
+        }
+    }
+
+
+
+    template<class V, class I>
+    VarintCSR<V, I> build_varint(const BasicCSR<V, I>& coord) {
+        VarintCSR<V, I> a;
+        a.row = coord.row;
+        a.col = coord.col;
+        a.msize = coord.msize;
+        a.arr_row = coord.arr_row.clone();
+        a.arr_val = coord.arr_val.clone();
+        a.idx_row = AlignedBuffer<I>(static_cast<std::size_t>(coord.row) + 1);
+
+        int parts = static_cast<std::size_t>(coord.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_rows(coord, parts);
+        std::vector<std::uint64_t> part_bytes(parts + 1, 0);
+        std::vector<std::uint64_t> row_bytes(coord.row);
+
+        // 1st pass: encoded size of every row
+        parallel_for(parts, [&](int p) {
+            std::uint64_t total{ 0 };
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                I begin = coord.arr_row[i], end = coord.arr_row[i + 1];
+                std::uint64_t bytes = begin == end ? 0 : varint_size(first_code(i, coord.arr_col[begin]));
+                for (I k = begin + 1; k < end; k++) {
+                    if (coord.arr_col[k] < coord.arr_col[k - 1]) {
+                        throw std::runtime_error("Varint CSR needs rows sorted by column");
+                    }
+                    bytes += varint_size(static_cast<std::uint64_t>(coord.arr_col[k] - coord.arr_col[k - 1]));
+                }
+                row_bytes[i] = bytes;
+                total += bytes;
+            }
+            part_bytes[p + 1] = total;
+        });
+        for (int p = 0; p < parts; p++) {
+            part_bytes[p + 1] += part_bytes[p];
+        }
+        // the offsets are kept in I like arr_row, not in 64 bits: 8 bytes a row would eat the savings on short rows
+        if (part_bytes[parts] > static_cast<std::uint64_t>(std::numeric_limits<I>::max())) {
+            throw std::overflow_error("Varint CSR index data does not fit the index type");
+        }
+        a.arr_idx = AlignedBuffer<std::uint8_t>(part_bytes[parts]);
+
+        // 2nd pass: row offsets and the gaps
+        a.idx_row[0] = 0;
+        parallel_for(parts, [&](int p) {
+            std::uint64_t pos = part_bytes[p];
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                std::uint8_t* out = a.arr_idx.data() + pos;
+                I begin = coord.arr_row[i], end = coord.arr_row[i + 1];
+                if (begin != end) {
+                    out = put_varint(out, first_code(i, coord.arr_col[begin]));
+                }
+                for (I k = begin + 1; k < end; k++) {
+                    out = put_varint(out, static_cast<std::uint64_t>(coord.arr_col[k] - coord.arr_col[k - 1]));
+                }
+                pos += row_bytes[i];
+                a.idx_row[i + 1] = static_cast<I>(pos);
+            }
+        });
+        return a;
+    }
+
+    template<class V, class I>
+    void spmv(const VarintCSR<V, I>& a, const V* x, V* y) {
+        DotBytes<V, I> dot_bytes = pick_dot_bytes(a);
+        int parts = static_cast<std::size_t>(a.msize) < parallel_min_nnz ? 1 : thread_count();
+        std::vector<I> bounds = partition_offsets(a.arr_row.data(), a.row, parts);
+        parallel_for(parts, [&](int p) {
+            for (I i = bounds[p]; i < bounds[p + 1]; i++) {
+                y[i] = dot_row(a, i, x, dot_bytes);
+            }
+        });
+    }
+
+
+
+#define PROG1_INSTANTIATE(V, I) \
+    template VarintCSR<V, I> build_varint<V, I>(const BasicCSR<V, I>&); \
+    template void spmv<V, I>(const VarintCSR<V, I>&, const V*, V*);
+    PROG1_CSR_INSTANTIATIONS(PROG1_INSTANTIATE)
+#undef PROG1_INSTANTIATE
+}
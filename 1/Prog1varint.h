@@ -0,0 +1,37 @@
+#ifndef OOPPROG1_PROG1VARINT_H
+#define OOPPROG1_PROG1VARINT_H
+
+#include <cstdint>
+#include "Prog1.h"
+
+namespace Prog1 {
+    // CSR with compressed column indices for bandwidth-bound SpMV: every row stores the gaps between
+    // its consecutive columns as LEB128 varints - 7 bits per byte, the high bit set on every byte but the
+    // last. The first column is stored as its zigzag-coded distance from the row index. Columns are sorted,
+    // so on banded matrices all of them take one byte instead of sizeof(I)
+    template<class V, class I>
+    struct VarintCSR {
+        I row{ 0 }, col{ 0 }, msize{ 0 };
+        AlignedBuffer<I> arr_row;             // as in BasicCSR: row i has the values arr_val[arr_row[i] .. arr_row[i + 1])
+        AlignedBuffer<I> idx_row;             // row i has the index bytes arr_idx[idx_row[i] .. idx_row[i + 1])
+        AlignedBuffer<std::uint8_t> arr_idx;
+        AlignedBuffer<V> arr_val;
+
+        // bytes of column index data per element (sizeof(I) + sizeof(I) / nnz per row for plain CSR)
+        double index_bytes_per_nnz() const {
+            return msize == 0 ? 0.0
+                              : (static_cast<double>(arr_idx.size()) + static_cast<double>(idx_row.size()) * sizeof(I)
+                                 + static_cast<double>(arr_row.size()) * sizeof(I)) / msize;
+        }
+    };
+
+    // encodes the columns of coord (its rows must be sorted by column, as every CSR built here is)
+    template<class V, class I>
+    VarintCSR<V, I> build_varint(const BasicCSR<V, I>& coord);
+
+    // y = A * x, the columns are decoded on the fly
+    template<class V, class I>
+    void spmv(const VarintCSR<V, I>& a, const V* x, V* y);
+}
+
+#endif //OOPPROG1_PROG1VARINT_H
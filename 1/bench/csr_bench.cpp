@@ -0,0 +1,391 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Prog1.h"
+#include "Prog1elementwise.h"
+#include "Prog1hyb.h"
+#include "Prog1kernels.h"
+#include "Prog1reorder.h"
+#include "Prog1sell.h"
+#include "Prog1trisolve.h"
+#include "Prog1varint.h"
+#include "generators.h"
+
+// Usage: csr_bench [--n=N] [--nnz_per_row=K] [--band=W] [--block=B] [--dense_rows=D] [--dense_n=N] [benchmark flags]
+// Results go to csr_bench.json unless --benchmark_out is given.
+
+namespace {
+    struct Config {
+        std::int64_t n = 1 << 18;
+        double nnz_per_row = 16;
+        std::int64_t band = 8;
+        std::int64_t block = 16;
+        std::int64_t dense_rows = 4; // nearly full rows of the arrow matrix
+        std::int64_t dense_n = 2048; // dense output prints n * n cells, so it gets its own size
+    };
+
+    Config config;
+
+    const char* kinds[] = { "uniform", "banded", "block", "rmat", "arrow" };
+
+    Prog1bench::Coo generate(const std::string& kind, std::int64_t n) {
+        if (kind == "uniform") {
+            return Prog1bench::uniform_random(n, config.nnz_per_row);
+        }
+        if (kind == "banded") {
+            return Prog1bench::banded(n, config.band);
+        }
+        if (kind == "block") {
+            return Prog1bench::block_diagonal(n, config.block);
+        }
+        if (kind == "arrow") {
+            return Prog1bench::arrow(n, config.band, config.dense_rows);
+        }
+        return Prog1bench::rmat(n, config.nnz_per_row);
+    }
+
+    // generated once per kind and size
+    const Prog1bench::Coo& coo(const std::string& kind, std::int64_t n) {
+        static std::map<std::pair<std::string, std::int64_t>, Prog1bench::Coo> cache;
+        auto key = std::make_pair(kind, n);
+        auto it = cache.find(key);
+        if (it == cache.end()) {
+            it = cache.emplace(key, generate(kind, n)).first;
+        }
+        return it->second;
+    }
+
+    // COO converted to the index and value types of the matrix
+    template<class V, class I>
+    struct TypedCoo {
+        I rows, cols;
+        std::vector<I> row, col;
+        std::vector<V> val;
+
+        explicit TypedCoo(const Prog1bench::Coo& m)
+            : rows(static_cast<I>(m.rows)), cols(static_cast<I>(m.cols)),
+              row(m.row.begin(), m.row.end()), col(m.col.begin(), m.col.end()) {
+            val.reserve(m.val.size());
+            for (double v : m.val) {
+                val.push_back(static_cast<V>(v));
+            }
+        }
+
+        Prog1::BasicCSR<V, I> build() const {
+            return Prog1::build_csr_from_coo<V, I>(rows, cols, row.data(), col.data(), val.data(),
+                                                   static_cast<I>(val.size()));
+        }
+    };
+
+    template<class V, class I>
+    const Prog1::BasicCSR<V, I>& matrix(const std::string& kind, std::int64_t n) {
+        static std::map<std::pair<std::string, std::int64_t>, std::unique_ptr<Prog1::BasicCSR<V, I>>> cache;
+        auto key = std::make_pair(kind, n);
+        auto& slot = cache[key];
+        if (!slot) {
+            slot = std::make_unique<Prog1::BasicCSR<V, I>>(TypedCoo<V, I>(coo(kind, n)).build());
+        }
+        return *slot;
+    }
+
+    template<class V, class I>
+    double storage_bytes(const Prog1::BasicCSR<V, I>& a) {
+        return (static_cast<double>(a.row) + 1) * sizeof(I) + static_cast<double>(a.msize) * (sizeof(I) + sizeof(V));
+    }
+
+    // bytes per nonzero of the stored matrix and the traffic rate of one pass over `bytes` (GB per second)
+    template<class V, class I>
+    void report(benchmark::State& state, const Prog1::BasicCSR<V, I>& a, double bytes) {
+        state.counters["nnz"] = static_cast<double>(a.msize);
+        state.counters["bytes_per_nnz"] = a.msize ? storage_bytes(a) / a.msize : 0.0;
+        state.counters["GB"] = benchmark::Counter(bytes * 1e-9, benchmark::Counter::kIsIterationInvariantRate);
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * a.msize));
+    }
+
+    template<class V, class I>
+    void bm_build(benchmark::State& state, std::string kind) {
+        TypedCoo<V, I> m(coo(kind, config.n));
+        for (auto _ : state) {
+            auto a = m.build();
+            benchmark::DoNotOptimize(a.arr_val.data());
+        }
+        const auto& a = matrix<V, I>(kind, config.n);
+        double input = static_cast<double>(a.msize) * (2 * sizeof(I) + sizeof(V));
+        report(state, a, input + storage_bytes(a));
+    }
+
+    template<class V, class I>
+    void bm_specialfunc(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        for (auto _ : state) {
+            state.PauseTiming();
+            auto copy = a.clone();
+            state.ResumeTiming();
+            Prog1::specialfunc(copy);
+            benchmark::DoNotOptimize(copy.arr_val.data());
+        }
+        report(state, a, 2 * storage_bytes(a));
+    }
+
+    template<class V, class I>
+    void bm_get_value(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        const int queries = 1 << 16;
+        std::mt19937_64 gen(3);
+        std::vector<I> qi(queries), qj(queries);
+        for (int q = 0; q < queries; q++) {
+            // half of the queries hit stored elements
+            I i = static_cast<I>(gen() % a.row);
+            qi[q] = i;
+            I len = a.arr_row[i + 1] - a.arr_row[i];
+            qj[q] = (q % 2 && len > 0) ? a.arr_col[a.arr_row[i] + gen() % len] : static_cast<I>(gen() % a.col);
+        }
+        for (auto _ : state) {
+            V sum{ 0 };
+            for (int q = 0; q < queries; q++) {
+                sum += Prog1::get_value(a, qi[q], qj[q]);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.counters["nnz"] = static_cast<double>(a.msize);
+        state.SetItemsProcessed(state.iterations() * queries);
+    }
+
+    // stream that drops everything, so the dense writer is timed without the disk
+    class NullBuffer : public std::streambuf {
+    protected:
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+        int overflow(int c) override { return c; }
+    };
+
+    template<class V, class I>
+    void bm_output(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.dense_n);
+        NullBuffer null;
+        std::ostream out(&null);
+        for (auto _ : state) {
+            Prog1::write_dense(a, out);
+        }
+        state.counters["cells"] = static_cast<double>(a.row) * a.col;
+        report(state, a, storage_bytes(a));
+    }
+
+    template<class V, class I>
+    double spmv_bytes(const Prog1::BasicCSR<V, I>& a) {
+        return storage_bytes(a) + (static_cast<double>(a.col) + a.row) * sizeof(V);
+    }
+
+    template<class V, class I>
+    void bm_spmv_csr(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        std::vector<V> x(a.col, V{ 1 }), y(a.row);
+        for (auto _ : state) {
+            Prog1::spmv(a, x.data(), y.data());
+            benchmark::ClobberMemory();
+        }
+        report(state, a, spmv_bytes(a));
+    }
+
+    template<class V, class I>
+    void bm_spmv_sell(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        auto sell = Prog1::build_sell(a);
+        std::vector<V> x(a.col, V{ 1 }), y(a.row);
+        for (auto _ : state) {
+            Prog1::spmv(sell, x.data(), y.data());
+            benchmark::ClobberMemory();
+        }
+        state.counters["fill_ratio"] = sell.fill_ratio();
+        report(state, a, spmv_bytes(a));
+    }
+
+    // same pass over the compressed indices; the GB rate counts the bytes actually read
+    template<class V, class I>
+    void bm_spmv_varint(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        auto v = Prog1::build_varint(a);
+        std::vector<V> x(a.col, V{ 1 }), y(a.row);
+        for (auto _ : state) {
+            Prog1::spmv(v, x.data(), y.data());
+            benchmark::ClobberMemory();
+        }
+        double index_bytes = v.index_bytes_per_nnz() * a.msize;
+        state.counters["index_bytes_per_nnz"] = v.index_bytes_per_nnz();
+        report(state, a, index_bytes + static_cast<double>(a.msize) * sizeof(V) + (static_cast<double>(a.col) + a.row) * sizeof(V));
+    }
+
+    // A + A^T and the Hadamard product A o A^T: two different structures of the same size
+    template<class V, class I>
+    void bm_elementwise(benchmark::State& state, std::string kind, Prog1::ElementOp op) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        auto t = Prog1::transpose(a);
+        I out_nnz{ 0 };
+        for (auto _ : state) {
+            auto c = Prog1::elementwise(a, t, op);
+            out_nnz = c.msize;
+            benchmark::DoNotOptimize(c.arr_val.data());
+        }
+        state.counters["out_nnz"] = static_cast<double>(out_nnz);
+        report(state, a, 2 * storage_bytes(a) + static_cast<double>(out_nnz) * (sizeof(I) + sizeof(V)));
+    }
+
+    // dense rows without column indices; the GB rate counts the bytes actually read
+    template<class V, class I>
+    void bm_spmv_hyb(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        auto hyb = Prog1::build_hybrid(a);
+        std::vector<V> x(a.col, V{ 1 }), y(a.row);
+        for (auto _ : state) {
+            Prog1::spmv(hyb, x.data(), y.data());
+            benchmark::ClobberMemory();
+        }
+        double dense_bytes = static_cast<double>(hyb.dense_val.size()) * sizeof(V);
+        state.counters["dense_rows"] = static_cast<double>(hyb.dense_count());
+        report(state, a, storage_bytes(hyb.sparse) + dense_bytes + (static_cast<double>(a.col) + a.row) * sizeof(V));
+    }
+
+    // the same SpMV after reverse Cuthill-McKee; compare with spmv_csr for the effect of the narrower band
+    template<class V, class I>
+    void bm_spmv_rcm(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        auto perm = Prog1::reorder_permutation(a);
+        auto b = Prog1::permute(a, perm);
+        std::vector<V> x(a.col, V{ 1 }), px(a.col), y(a.row);
+        Prog1::permute_vector(perm, x.data(), px.data());
+        for (auto _ : state) {
+            Prog1::spmv(b, px.data(), y.data());
+            benchmark::ClobberMemory();
+        }
+        state.counters["bandwidth_before"] = static_cast<double>(Prog1::bandwidth(a));
+        state.counters["bandwidth_after"] = static_cast<double>(Prog1::bandwidth(b));
+        report(state, b, spmv_bytes(b));
+    }
+
+    template<class V, class I>
+    void bm_reorder(benchmark::State& state, std::string kind) {
+        const auto& a = matrix<V, I>(kind, config.n);
+        for (auto _ : state) {
+            auto perm = Prog1::reorder_permutation(a);
+            benchmark::DoNotOptimize(perm.data());
+        }
+        report(state, a, storage_bytes(a));
+    }
+
+    // forward substitution with the strictly lower part of the matrix and a unit diagonal; the level sets are
+    // found before the timing, as a preconditioner applied many times would
+    template<class V, class I>
+    void bm_trisolve(benchmark::State& state, std::string kind) {
+        const auto& m = coo(kind, config.n);
+        Prog1bench::Coo lower;
+        lower.rows = lower.cols = m.rows;
+        for (std::size_t k = 0; k < m.val.size(); k++) {
+            if (m.col[k] < m.row[k]) {
+                lower.row.push_back(m.row[k]);
+                lower.col.push_back(m.col[k]);
+                lower.val.push_back(m.val[k]);
+            }
+        }
+        for (std::int64_t i = 0; i < m.rows; i++) {
+            lower.row.push_back(i);
+            lower.col.push_back(i);
+            lower.val.push_back(1.0);
+        }
+        Prog1::TriangularSolver<V, I> solver(TypedCoo<V, I>(lower).build(), Prog1::Triangle::lower);
+        const auto& l = solver.matrix();
+        solver.levels();
+        std::vector<V> b(l.row, V{ 1 }), x(l.row);
+        for (auto _ : state) {
+            solver.solve(b.data(), x.data());
+            benchmark::ClobberMemory();
+        }
+        state.counters["levels"] = static_cast<double>(solver.levels().levels());
+        report(state, l, spmv_bytes(l));
+    }
+
+    template<class V, class I>
+    void register_all(const std::string& types) {
+        for (const char* kind : kinds) {
+            std::string suffix = std::string("/") + kind + "/" + types;
+            benchmark::RegisterBenchmark(("build" + suffix).c_str(), bm_build<V, I>, kind)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("specialfunc" + suffix).c_str(), bm_specialfunc<V, I>, kind)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("get_value" + suffix).c_str(), bm_get_value<V, I>, kind)->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("output" + suffix).c_str(), bm_output<V, I>, kind)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("add" + suffix).c_str(), bm_elementwise<V, I>, kind, Prog1::ElementOp::add)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("hadamard" + suffix).c_str(), bm_elementwise<V, I>, kind, Prog1::ElementOp::multiply)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("spmv_csr" + suffix).c_str(), bm_spmv_csr<V, I>, kind)->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("spmv_sell" + suffix).c_str(), bm_spmv_sell<V, I>, kind)->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("spmv_varint" + suffix).c_str(), bm_spmv_varint<V, I>, kind)->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("spmv_hyb" + suffix).c_str(), bm_spmv_hyb<V, I>, kind)->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("spmv_rcm" + suffix).c_str(), bm_spmv_rcm<V, I>, kind)->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("reorder" + suffix).c_str(), bm_reorder<V, I>, kind)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("trisolve" + suffix).c_str(), bm_trisolve<V, I>, kind)->Unit(benchmark::kMicrosecond);
+        }
+    }
+
+    // takes our own --name=value flags out of argv
+    void parse_flags(int& argc, char** argv) {
+        int out = 1;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&](const std::string& name) -> const char* {
+                std::string prefix = "--" + name + "=";
+                return arg.rfind(prefix, 0) == 0 ? argv[i] + prefix.size() : nullptr;
+            };
+            if (const char* v = value("n")) {
+                config.n = std::atoll(v);
+            } else if (const char* v = value("nnz_per_row")) {
+                config.nnz_per_row = std::atof(v);
+            } else if (const char* v = value("band")) {
+                config.band = std::atoll(v);
+            } else if (const char* v = value("block")) {
+                config.block = std::atoll(v);
+            } else if (const char* v = value("dense_rows")) {
+                config.dense_rows = std::atoll(v);
+            } else if (const char* v = value("dense_n")) {
+                config.dense_n = std::atoll(v);
+            } else {
+                argv[out++] = argv[i];
+            }
+        }
+        argc = out;
+    }
+}
+
+int main(int argc, char** argv) {
+    parse_flags(argc, argv);
+
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (char* a : args) {
+        has_out = has_out || std::string(a).rfind("--benchmark_out=", 0) == 0;
+    }
+    std::string out_file = "--benchmark_out=csr_bench.json";
+    std::string out_format = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out_file.data());
+        args.push_back(out_format.data());
+    }
+    int n = static_cast<int>(args.size());
+
+    register_all<int, int>("int_int");
+    register_all<double, std::uint32_t>("double_u32");
+
+    benchmark::Initialize(&n, args.data());
+    if (benchmark::ReportUnrecognizedArguments(n, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <random>
+#include "generators.h"
+
+namespace Prog1bench {
+    namespace {
+        void push(Coo& m, std::int64_t i, std::int64_t j, double v) {
+            m.row.push_back(i);
+            m.col.push_back(j);
+            m.val.push_back(v);
+        }
+
+        double value(std::mt19937_64& gen) {
+            return static_cast<double>(static_cast<int>(gen() % 19) - 9);
+        }
+    }
+
+    Coo uniform_random(std::int64_t n, double nnz_per_row, std::uint64_t seed) {
+        Coo m;
+        m.rows = m.cols = n;
+        std::mt19937_64 gen(seed);
+        std::int64_t nnz = static_cast<std::int64_t>(n * nnz_per_row);
+        m.row.reserve(nnz);
+        m.col.reserve(nnz);
+        m.val.reserve(nnz);
+        for (std::int64_t k = 0; k < nnz; k++) {
+            push(m, gen() % n, gen() % n, value(gen));
+        }
+        return m;
+    }
+
+    Coo banded(std::int64_t n, std::int64_t half_width) {
+        Coo m;
+        m.rows = m.cols = n;
+        std::mt19937_64 gen(7);
+        for (std::int64_t i = 0; i < n; i++) {
+            for (std::int64_t j = std::max<std::int64_t>(0, i - half_width); j <= std::min(n - 1, i + half_width); j++) {
+                push(m, i, j, value(gen));
+            }
+        }
+        return m;
+    }
+
+    Coo block_diagonal(std::int64_t n, std::int64_t block) {
+        Coo m;
+        m.rows = m.cols = n;
+        std::mt19937_64 gen(11);
+        for (std::int64_t b = 0; b < n; b += block) {
+            std::int64_t end = std::min(n, b + block);
+            for (std::int64_t i = b; i < end; i++) {
+                for (std::int64_t j = b; j < end; j++) {
+                    push(m, i, j, value(gen));
+                }
+            }
+        }
+        return m;
+    }
+
+    Coo arrow(std::int64_t n, std::int64_t half_width, std::int64_t dense_rows) {
+        Coo m;
+        m.rows = m.cols = n;
+        std::mt19937_64 gen(13);
+        std::int64_t stride = dense_rows > 0 ? std::max<std::int64_t>(1, n / dense_rows) : n + 1;
+        for (std::int64_t i = 0; i < n; i++) {
+            if (i % stride == stride / 2) {
+                for (std::int64_t j = 0; j < n; j++) {
+                    if (gen() % 10 != 0) {
+                        push(m, i, j, value(gen));
+                    }
+                }
+                continue;
+            }
+            for (std::int64_t j = std::max<std::int64_t>(0, i - half_width); j <= std::min(n - 1, i + half_width); j++) {
+                push(m, i, j, value(gen));
+            }
+        }
+        return m;
+    }
+
+    Coo rmat(std::int64_t n, double nnz_per_row, std::uint64_t seed) {
+        int levels = 0;
+        while ((std::int64_t{ 1 } << levels) < n) {
+            levels++;
+        }
+        Coo m;
+        m.rows = m.cols = std::int64_t{ 1 } << levels;
+        std::mt19937_64 gen(seed);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        std::int64_t nnz = static_cast<std::int64_t>(m.rows * nnz_per_row);
+        m.row.reserve(nnz);
+        m.col.reserve(nnz);
+        m.val.reserve(nnz);
+        for (std::int64_t k = 0; k < nnz; k++) {
+            std::int64_t i = 0, j = 0;
+            for (int l = 0; l < levels; l++) {
+                double r = coin(gen);
+                int quadrant = r < 0.57 ? 0 : r < 0.76 ? 1 : r < 0.95 ? 2 : 3;
+                i = 2 * i + (quadrant >> 1);
+                j = 2 * j + (quadrant & 1);
+            }
+            push(m, i, j, value(gen));
+        }
+        return m;
+    }
+}
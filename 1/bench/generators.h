@@ -0,0 +1,27 @@
+#ifndef OOPPROG1_GENERATORS_H
+#define OOPPROG1_GENERATORS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace Prog1bench {
+    // matrix as COO triples, ready for Prog1::build_csr_from_coo
+    struct Coo {
+        std::int64_t rows{ 0 }, cols{ 0 };
+        std::vector<std::int64_t> row, col;
+        std::vector<double> val;
+    };
+
+    // nnz_per_row elements per row on average, at uniformly random columns
+    Coo uniform_random(std::int64_t n, double nnz_per_row, std::uint64_t seed = 1);
+    // every element within half_width of the diagonal
+    Coo banded(std::int64_t n, std::int64_t half_width);
+    // dense blocks of block x block elements on the diagonal
+    Coo block_diagonal(std::int64_t n, std::int64_t block);
+    // banded with half_width plus dense_rows rows spread over the matrix that hold 90% of the columns
+    Coo arrow(std::int64_t n, std::int64_t half_width, std::int64_t dense_rows);
+    // R-MAT (power-law degrees) with the usual a = 0.57, b = c = 0.19, n rounded up to a power of two
+    Coo rmat(std::int64_t n, double nnz_per_row, std::uint64_t seed = 1);
+}
+
+#endif //OOPPROG1_GENERATORS_H
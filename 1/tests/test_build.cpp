@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Prog1.h"
+#include "Prog1delta.h"
+#include "test_util.h"
+
+using namespace Prog1test;
+
+template<class T>
+class BuildTest : public ::testing::Test {};
+TYPED_TEST_SUITE(BuildTest, CsrTypes);
+
+namespace {
+    // what build_csr_from_coo must give: repeated (row, col) combined by dup in input order
+    template<class V, class I>
+    std::map<std::pair<I, I>, V> reference(const Coo<V, I>& m, Prog1::Duplicates dup) {
+        std::map<std::pair<I, I>, V> out;
+        for (std::size_t k = 0; k < m.val.size(); k++) {
+            auto [it, fresh] = out.try_emplace({ m.row[k], m.col[k] }, m.val[k]);
+            if (fresh) {
+                continue;
+            }
+            if (dup == Prog1::Duplicates::sum) {
+                it->second += m.val[k];
+            } else if (dup == Prog1::Duplicates::max) {
+                it->second = std::max(it->second, m.val[k]);
+            } else {
+                it->second = m.val[k];
+            }
+        }
+        return out;
+    }
+
+    // the elements sorted by (row, col), duplicates kept in input order
+    template<class V, class I>
+    Coo<V, I> sorted(const Coo<V, I>& m) {
+        std::vector<std::size_t> order(m.val.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) {
+            return std::make_pair(m.row[x], m.col[x]) < std::make_pair(m.row[y], m.col[y]);
+        });
+        Coo<V, I> s;
+        s.rows = m.rows;
+        s.cols = m.cols;
+        for (std::size_t k : order) {
+            s.row.push_back(m.row[k]);
+            s.col.push_back(m.col[k]);
+            s.val.push_back(m.val[k]);
+        }
+        return s;
+    }
+
+    // the specialfunc() of the first version of the lab: sort every row by column, then drop the elements
+    // to the left of the first row minimum that are greater than it
+    template<class V, class I>
+    std::map<std::pair<I, I>, V> original_specialfunc(const Prog1::BasicCSR<V, I>& a) {
+        std::map<std::pair<I, I>, V> out;
+        for (I i = 0; i < a.row; i++) {
+            std::vector<std::pair<I, V>> row;
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                row.push_back({ a.arr_col[k], a.arr_val[k] });
+            }
+            std::stable_sort(row.begin(), row.end(), [](auto& x, auto& y) { return x.first < y.first; });
+            std::size_t index = 0;
+            for (std::size_t j = 0; j < row.size(); j++) {
+                if (row[j].second < row[index].second) {
+                    index = j;
+                }
+            }
+            for (std::size_t j = 0; j < row.size(); j++) {
+                if (j >= index || !(row[j].second > row[index].second)) {
+                    out[{ i, row[j].first }] = row[j].second;
+                }
+            }
+        }
+        return out;
+    }
+}
+
+TYPED_TEST(BuildTest, MatchesMapReferenceForEveryDuplicatePolicy) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // the large cases take the parallel radix sort, the sorted ones the presorted path
+    for (auto [rows, cols, density] : { std::tuple<I, I, double>{ 40, 30, 0.3 }, { 3000, 2000, 0.02 }, { 1, 500, 0.5 } }) {
+        Coo<V, I> m = random_coo<V, I>(rows, cols, density, 7);
+        for (const Coo<V, I>& input : { m, sorted(m) }) {
+            for (auto dup : { Prog1::Duplicates::sum, Prog1::Duplicates::max, Prog1::Duplicates::last }) {
+                auto a = input.build(dup);
+                EXPECT_TRUE(is_canonical(a));
+                EXPECT_EQ(a.row, rows);
+                EXPECT_EQ(a.col, cols);
+                EXPECT_EQ(elements(a), reference(input, dup)) << rows << " x " << cols << ", dup " << static_cast<int>(dup);
+            }
+        }
+    }
+}
+
+TYPED_TEST(BuildTest, CanonicalizeMatchesBuild) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    Coo<V, I> m = random_coo<V, I>(200, 100, 0.1, 3);
+    // the same elements in input order inside every row, repeats included
+    Coo<V, I> s = sorted(m);
+    Prog1::BasicCSR<V, I> a;
+    a.allocate(s.rows, static_cast<I>(s.val.size()));
+    a.col = s.cols;
+    std::fill(a.arr_row.begin(), a.arr_row.end(), I{ 0 });
+    for (I r : s.row) {
+        a.arr_row[r + 1]++;
+    }
+    for (I i = 0; i < a.row; i++) {
+        a.arr_row[i + 1] += a.arr_row[i];
+    }
+    std::vector<I> pos(a.arr_row.begin(), a.arr_row.end() - 1);
+    for (std::size_t k = 0; k < m.val.size(); k++) {
+        I at = pos[m.row[k]]++;
+        a.arr_col[at] = m.col[k];
+        a.arr_val[at] = m.val[k];
+    }
+    Prog1::canonicalize(a, Prog1::Duplicates::last);
+    EXPECT_TRUE(is_canonical(a));
+    EXPECT_EQ(elements(a), reference(m, Prog1::Duplicates::last));
+}
+
+TYPED_TEST(BuildTest, GetValueMatchesElements) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(60, 50, 0.2, 5);
+    auto ref = elements(a);
+    for (I i = 0; i < a.row; i++) {
+        for (I j = 0; j < a.col; j++) {
+            auto it = ref.find({ i, j });
+            EXPECT_EQ(Prog1::get_value(a, i, j), it == ref.end() ? V{ 0 } : it->second);
+        }
+    }
+}
+
+TYPED_TEST(BuildTest, SpecialfuncKeepsTheOriginalSemantics) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    for (auto [rows, cols, density] : { std::tuple<I, I, double>{ 50, 40, 0.3 }, { 4000, 3000, 0.01 } }) {
+        auto a = random_csr<V, I>(rows, cols, density, 11);
+        // rows reversed, so that specialfunc has to sort them first
+        for (I i = 0; i < a.row; i++) {
+            std::reverse(a.arr_col.begin() + a.arr_row[i], a.arr_col.begin() + a.arr_row[i + 1]);
+            std::reverse(a.arr_val.begin() + a.arr_row[i], a.arr_val.begin() + a.arr_row[i + 1]);
+        }
+        auto expected = original_specialfunc(a);
+        Prog1::specialfunc(a);
+        EXPECT_TRUE(is_canonical(a));
+        EXPECT_EQ(elements(a), expected);
+    }
+}
+
+TYPED_TEST(BuildTest, DeltaEditsKeepTheLastWrite) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(40, 30, 0.2, 12);
+    auto expected = elements(a);
+    // a small log, so that it is compacted several times on the way
+    Prog1::DeltaCSR<V, I> d(std::move(a), 64);
+    std::mt19937_64 gen(13);
+    for (int step = 0; step < 2000; step++) {
+        // a few elements edited over and over
+        I i = static_cast<I>(gen() % 8), j = static_cast<I>(gen() % 6);
+        if (gen() % 4 == 0) {
+            d.remove(i, j);
+            expected.erase({ i, j });
+        } else {
+            V v = static_cast<V>(gen() % 100);
+            d.set(i, j, v);
+            expected[{ i, j }] = v;
+        }
+        if (step % 37 == 0) {
+            I ri = static_cast<I>(gen() % 8), rj = static_cast<I>(gen() % 6);
+            auto it = expected.find({ ri, rj });
+            EXPECT_EQ(d.get_value(ri, rj), it == expected.end() ? V{ 0 } : it->second);
+        }
+    }
+    EXPECT_TRUE(is_canonical(d.csr()));
+    EXPECT_EQ(elements(d.csr()), expected);
+    EXPECT_EQ(d.pending(), 0u);
+}
+
+// small arenas grow by copying, from Arena::map_threshold on they are mapped and grow with mremap;
+// the offsets and the elements kept must survive both
+TYPED_TEST(BuildTest, ResizeNnzAcrossTheMapThreshold) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    const std::size_t per_element = sizeof(I) + sizeof(V);
+    const std::size_t threshold_nnz = Prog1::Arena::map_threshold / per_element;
+    const I rows = 1000;
+    Prog1::BasicCSR<V, I> a;
+    a.allocate(rows, 100);
+    a.col = 50;
+    for (I i = 0; i <= rows; i++) {
+        a.arr_row[i] = static_cast<I>(i % 7);
+    }
+    auto fill = [&](I from) {
+        for (I k = from; k < a.msize; k++) {
+            a.arr_col[k] = static_cast<I>(k % 50);
+            a.arr_val[k] = static_cast<V>(static_cast<int>(k % 101) - 50);
+        }
+    };
+    auto intact = [&](I count) {
+        for (I i = 0; i <= rows; i++) {
+            if (a.arr_row[i] != static_cast<I>(i % 7)) {
+                return false;
+            }
+        }
+        for (I k = 0; k < count; k++) {
+            if (a.arr_col[k] != static_cast<I>(k % 50) || a.arr_val[k] != static_cast<V>(static_cast<int>(k % 101) - 50)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    fill(0);
+    // copied growth, then across the threshold, then remapped growth, then shrinking
+    for (std::size_t nnz : { std::size_t{ 5000 }, threshold_nnz / 2, threshold_nnz * 2, threshold_nnz * 5, threshold_nnz }) {
+        I before = a.msize;
+        a.resize_nnz(static_cast<I>(nnz));
+        EXPECT_EQ(a.msize, static_cast<I>(nnz));
+        EXPECT_EQ(a.row, rows);
+        EXPECT_GE(a.storage.capacity(), nnz * per_element);
+        EXPECT_EQ(a.storage.capacity() >= Prog1::Arena::map_threshold, nnz >= threshold_nnz) << nnz;
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.arr_col.data()) % 64, 0u);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.arr_val.data()) % 64, 0u);
+        EXPECT_TRUE(intact(std::min(before, a.msize))) << "after growing to " << nnz;
+        fill(before < a.msize ? before : a.msize);
+    }
+    EXPECT_TRUE(intact(a.msize));
+}
+
+TEST(Build, SpecialfuncOnASmallMatrix) {
+    // row 0: 5 3 1 4 -> 1 4; row 1 empty; row 2: 2 2 -> 2 2 (the first minimum is the first element)
+    int row[] = { 0, 0, 0, 0, 2, 2 }, col[] = { 0, 1, 2, 3, 0, 1 }, val[] = { 5, 3, 1, 4, 2, 2 };
+    auto a = Prog1::build_csr_from_coo<int, int>(3, 4, row, col, val, 6);
+    Prog1::specialfunc(a);
+    EXPECT_EQ(a.msize, 4);
+    EXPECT_EQ(Prog1::get_value(a, 0, 1), 0);
+    EXPECT_EQ(Prog1::get_value(a, 0, 2), 1);
+    EXPECT_EQ(Prog1::get_value(a, 0, 3), 4);
+    EXPECT_EQ(Prog1::get_value(a, 2, 0), 2);
+}
@@ -0,0 +1,339 @@
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Prog1.h"
+#include "Prog1io.h"
+#include "Prog1kernels.h"
+#include "test_util.h"
+
+using namespace Prog1test;
+
+template<class T>
+class IoTest : public ::testing::Test {};
+TYPED_TEST_SUITE(IoTest, CsrTypes);
+
+namespace {
+    // general Matrix Market text of a, elements row by row
+    template<class V, class I>
+    std::string to_mtx(const Prog1::BasicCSR<V, I>& a) {
+        std::ostringstream out;
+        out << "%%MatrixMarket matrix coordinate " << (std::is_floating_point_v<V> ? "real" : "integer") << " general\n";
+        out << "% written by the tests\n";
+        out << a.row << " " << a.col << " " << a.msize << "\n";
+        for (I i = 0; i < a.row; i++) {
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                out << i + 1 << " " << a.arr_col[k] + 1 << " " << a.arr_val[k] << "\n";
+            }
+        }
+        return out.str();
+    }
+
+    void write_file(const std::string& path, const std::string& text) {
+        std::ofstream(path, std::ios::binary) << text;
+    }
+
+    // overwrites the bytes of value at offset in the file
+    template<class T>
+    void patch_file(const std::string& path, std::uint64_t offset, T value) {
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(static_cast<std::streamoff>(offset));
+        f.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+TYPED_TEST(IoTest, BinaryFileRoundTrip) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(700, 300, 0.05, 21);
+    TempFile file("round_trip.csr");
+    Prog1::save_csr(a, file.path());
+    Prog1::CSRMapped<V, I> mapped(file.path(), true);
+    EXPECT_TRUE(mapped.verify());
+    EXPECT_EQ(mapped.csr().row, a.row);
+    EXPECT_EQ(mapped.csr().col, a.col);
+    EXPECT_EQ(elements(mapped.csr()), elements(a));
+    EXPECT_EQ(Prog1::csr_checksum(mapped.csr()), Prog1::csr_checksum(a));
+}
+
+TEST(Io, DamagedBinaryFilesThrow) {
+    // 4 x 3, elements (0,0) (0,2) (2,1) (3,0): the offsets start at byte 64, the columns at byte 128
+    Prog1::BasicCSR<int, std::uint64_t> a;
+    a.allocate(4, 4);
+    a.col = 3;
+    const std::uint64_t rows[] = { 0, 2, 2, 3, 4 }, cols[] = { 0, 2, 1, 0 };
+    std::copy(std::begin(rows), std::end(rows), a.arr_row.data());
+    std::copy(std::begin(cols), std::end(cols), a.arr_col.data());
+    std::fill(a.arr_val.data(), a.arr_val.data() + 4, 1);
+    const std::uint64_t row_off = 64, col_off = 128;
+    TempFile file("damaged.csr");
+    // a fresh copy, which opens cleanly
+    auto reload = [&] {
+        Prog1::save_csr(a, file.path());
+        Prog1::CSRMapped<int, std::uint64_t> mapped(file.path());
+    };
+    using Mapped = Prog1::CSRMapped<int, std::uint64_t>;
+
+    reload();
+    patch_file(file.path(), 8, std::uint32_t{ 1 });                 // version 1 kept reserved words there
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+
+    reload();
+    patch_file(file.path(), 32, std::int64_t{ 1 } << 62);         // msize whose byte size wraps
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+
+    reload();
+    patch_file(file.path(), row_off + 2 * 8, std::uint64_t{ 1 }); // offsets going back
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+
+    reload();
+    patch_file(file.path(), col_off + 2 * 8, std::uint64_t{ 3 }); // column out of range
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+
+    reload();
+    patch_file(file.path(), col_off + 1 * 8, std::uint64_t{ 0 }); // repeated column in a row
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+    Prog1::RowBlockReader<int, std::uint64_t> reader(file.path(), 8);
+    Prog1::BasicCSR<int, std::uint64_t> block;
+    std::uint64_t first{ 0 };
+    EXPECT_THROW(reader.next(block, first), std::runtime_error);
+
+    // offsets that do not go back but start past 0 or end short of msize
+    using Reader = Prog1::RowBlockReader<int, std::uint64_t>;
+    reload();
+    patch_file(file.path(), row_off, std::uint64_t{ 1 });
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+    EXPECT_THROW(Reader(file.path(), 2), std::runtime_error);
+
+    reload();
+    patch_file(file.path(), row_off + 4 * 8, std::uint64_t{ 3 });
+    EXPECT_THROW(Mapped{ file.path() }, std::runtime_error);
+    EXPECT_THROW(Reader(file.path(), 2), std::runtime_error);
+}
+
+TYPED_TEST(IoTest, MatrixMarketRoundTrip) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(300, 200, 0.05, 22);
+    std::string text = to_mtx(a);
+    TempFile file("round_trip.mtx");
+    write_file(file.path(), text);
+    EXPECT_EQ(elements(Prog1::load_mtx<V, I>(file.path())), elements(a));
+    EXPECT_EQ(elements(Prog1::parse_mtx<V, I>(text.data(), text.data() + text.size())), elements(a));
+}
+
+TEST(Io, MalformedMatrixMarketThrows) {
+    const std::string banner = "%%MatrixMarket matrix coordinate integer general\n";
+    auto parse = [](const std::string& text) { return Prog1::parse_mtx<int, int>(text.data(), text.data() + text.size()); };
+    // blank lines between the elements, no line break after the last one
+    EXPECT_EQ(elements(parse(banner + "3 3 2\n1 1 5\n\n3 2 -1")).size(), 2u);
+
+    for (const char* body : { "2 2 1000000000\n1 1 1\n",  // far more elements than the text can hold
+                                     "3 3 2\n1 1\n5\n2 2 1\n",     // an element split over two lines
+                                     "3 3 2\n1 1 5 2\n2 1\n",       // two elements run together
+                                     "3 3 1\n1 1 5x\n",             // glued tokens
+                                     "3 3 1\n1 1 5-2\n",
+                                     "3 3\n1\n1 1 5\n" }) {          // a split size line
+        EXPECT_THROW(parse(banner + body), std::runtime_error) << body;
+    }
+    try {
+        parse(banner + "% comment\n3 3 2\n1 1 5\n2 2 \n");
+        ADD_FAILURE() << "an element without its value was accepted";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("line 5"), std::string::npos) << e.what();
+    }
+}
+
+TYPED_TEST(IoTest, RowBlocksRoundTrip) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(1000, 150, 0.04, 23);
+    TempFile mtx("blocks.mtx"), csr("blocks.csr"), copy("blocks_copy.csr");
+    write_file(mtx.path(), to_mtx(a));
+    Prog1::save_csr(a, csr.path());
+    for (const std::string& path : { mtx.path(), csr.path() }) {
+        Prog1::RowBlockReader<V, I> reader(path, 500);
+        EXPECT_EQ(reader.rows(), a.row);
+        EXPECT_EQ(reader.cols(), a.col);
+        {
+            Prog1::CSRFileWriter<V, I> writer(copy.path(), reader.rows(), reader.cols());
+            Prog1::BasicCSR<V, I> block;
+            I first{ 0 }, expected_first{ 0 };
+            while (reader.next(block, first)) {
+                EXPECT_EQ(first, expected_first);
+                expected_first += block.row;
+                writer.append(block);
+            }
+            EXPECT_EQ(expected_first, a.row);
+            writer.finish();
+        }
+        Prog1::CSRMapped<V, I> mapped(copy.path(), true);
+        EXPECT_EQ(elements(mapped.csr()), elements(a)) << path;
+    }
+}
+
+// small blocks, so that several are read; both file formats
+TYPED_TEST(IoTest, StreamingMatchesInMemory) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // empty rows give 0 and -1
+    auto a = random_csr<V, I>(400, 60, 0.03, 25);
+    TempFile mtx("stream.mtx"), csr("stream.csr"), out("stream_out");
+    write_file(mtx.path(), to_mtx(a));
+    Prog1::save_csr(a, csr.path());
+
+    auto expected = a.clone();
+    Prog1::specialfunc(expected);
+    auto min = Prog1::row_min(a), max = Prog1::row_max(a), sum = Prog1::row_sum(a);
+    auto nnz = Prog1::row_nnz(a), argmin = Prog1::row_argmin(a);
+    // the lines of the out file as T
+    auto read_lines = [&]<class T>(T) {
+        std::ifstream in(out.path());
+        std::vector<T> lines;
+        for (T x; in >> x;) {
+            lines.push_back(x);
+        }
+        return lines;
+    };
+    for (const std::string& path : { mtx.path(), csr.path() }) {
+        Prog1::stream_specialfunc<V, I>(path, out.path(), 50);
+        EXPECT_EQ(elements(Prog1::CSRMapped<V, I>(out.path(), true).csr()), elements(expected)) << path;
+
+        Prog1::stream_row_reduction<V, I>(path, out.path(), Prog1::RowReduction::min, 50);
+        EXPECT_EQ(read_lines(V{}), min) << path;
+        Prog1::stream_row_reduction<V, I>(path, out.path(), Prog1::RowReduction::max, 50);
+        EXPECT_EQ(read_lines(V{}), max) << path;
+        Prog1::stream_row_reduction<V, I>(path, out.path(), Prog1::RowReduction::sum, 50);
+        EXPECT_EQ(read_lines(V{}), sum) << path;
+        Prog1::stream_row_reduction<V, I>(path, out.path(), Prog1::RowReduction::nnz, 50);
+        EXPECT_EQ(read_lines(I{}), nnz) << path;
+        Prog1::stream_row_reduction<V, I>(path, out.path(), Prog1::RowReduction::argmin, 50);
+        std::vector<long long> columns;
+        for (I i = 0; i < a.row; i++) {
+            columns.push_back(argmin[i] == a.arr_row[i + 1] ? -1 : static_cast<long long>(a.arr_col[argmin[i]]));
+        }
+        EXPECT_EQ(read_lines(0LL), columns) << path;
+    }
+}
+
+// blocks of many short rows need more row offsets than one read of them brings in
+TEST(Io, RowBlocksSpanSeveralOffsetReads) {
+    auto a = random_csr<int, int>(300000, 10, 0.02, 26);
+    TempFile csr("long_blocks.csr");
+    Prog1::save_csr(a, csr.path());
+    Prog1::RowBlockReader<int, int> reader(csr.path(), 100000);
+    Prog1::BasicCSR<int, int> block;
+    int first{ 0 }, blocks{ 0 };
+    std::map<std::pair<int, int>, int> read;
+    while (reader.next(block, first)) {
+        EXPECT_EQ(first, blocks * 100000);
+        EXPECT_EQ(block.row, 100000);
+        for (auto& [key, v] : elements(block)) {
+            read[{ key.first + first, key.second }] = v;
+        }
+        blocks++;
+    }
+    EXPECT_EQ(blocks, 3);
+    EXPECT_EQ(read, elements(a));
+}
+
+TEST(Io, RowBlocksOfNothingAndOutOfOrderFiles) {
+    TempFile csr("empty_blocks.csr"), mtx("unordered.mtx");
+    auto a = random_csr<int, int>(20, 10, 0.3, 24);
+    {
+        Prog1::CSRFileWriter<int, int> writer(csr.path(), a.row, a.col);
+        Prog1::BasicCSR<int, int> none, no_rows;
+        no_rows.allocate(0, 0);
+        no_rows.arr_row[0] = 0;
+        writer.append(none);
+        writer.append(a);
+        writer.append(no_rows);
+        writer.finish();
+    }
+    EXPECT_EQ(elements(Prog1::CSRMapped<int, int>(csr.path(), true).csr()), elements(a));
+
+    write_file(mtx.path(), "%%MatrixMarket matrix coordinate integer general\n3 3 3\n2 1 5\n1 1 4\n3 3 6\n");
+    Prog1::RowBlockReader<int, int> reader(mtx.path(), 1);
+    Prog1::BasicCSR<int, int> block;
+    int first{ 0 };
+    try {
+        while (reader.next(block, first)) {
+        }
+        ADD_FAILURE() << "rows out of order were accepted";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("load_mtx"), std::string::npos) << e.what();
+    }
+    EXPECT_EQ(elements(Prog1::load_mtx<int, int>(mtx.path())).size(), 3u);
+}
+
+TEST(Io, TextInputAndDenseOutput) {
+    // rows, columns, element count, then column, row, value
+    Prog1::NumberReader in("2 3 3\n2 0 7\n0 1 -4\n0 0 5\n", "test");
+    auto a = Prog1::read_csr_text<int, int>(in);
+    std::ostringstream out;
+    Prog1::write_dense(a, out);
+    EXPECT_EQ(out.str(), "5\t0\t7\t\n-4\t0\t0\t\n");
+}
+
+TEST(Io, NumberReaderErrorsNameTheLineAndColumn) {
+    // message of the exception f() throws
+    auto error = [](auto f) {
+        try {
+            f();
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string("no exception");
+    };
+    Prog1::NumberReader glued("1 2\n  3x 4\n", "test");
+    EXPECT_EQ(glued.next<int>(), 1);
+    EXPECT_EQ(glued.next<int>(), 2);
+    EXPECT_EQ(error([&] { glued.next<int>(); }), "test, line 2, column 3: integer expected");
+
+    Prog1::NumberReader range("5\r\n\n\t-7", "test");
+    EXPECT_EQ(range.next<int>(0, 9), 5);
+    EXPECT_EQ(error([&] { range.next<int>(0, 9); }), "test, line 3, column 2: number out of the allowed range");
+
+    Prog1::NumberReader big("99999999999", "test");
+    EXPECT_EQ(error([&] { big.next<int>(); }), "test, line 1, column 1: number out of range");
+
+    Prog1::NumberReader rest("1.5 \n 2", "test");
+    EXPECT_EQ(rest.next<double>(), 1.5);
+    EXPECT_EQ(error([&] { rest.expect_end(); }), "test, line 2, column 2: unexpected data after the last number");
+    EXPECT_EQ(rest.next<double>(), 2.0);
+    EXPECT_EQ(error([&] { rest.next<double>(); }), "test, line 2, column 3: number expected, end of input found");
+
+    // the element count is checked against the text before the arrays are sized for it
+    Prog1::NumberReader huge("2 2 2000000000\n0 0 1\n", "test");
+    EXPECT_EQ(error([&] { Prog1::read_csr_text<int, int>(huge); }),
+              "test, line 2, column 1: more elements announced than the input holds");
+}
+
+TEST(Io, InputReadsRedirectedStdinInOnePass) {
+    TempFile file("stdin.txt");
+    write_file(file.path(), "2 3 2\n1 1 4\n2 0 -1\n");
+    int in = ::open(file.path().c_str(), O_RDONLY);
+    ASSERT_GE(in, 0);
+    int saved = ::dup(STDIN_FILENO);
+    ::dup2(in, STDIN_FILENO);
+    ::close(in);
+    auto restore = [&] {
+        ::dup2(saved, STDIN_FILENO);
+        ::close(saved);
+    };
+    try {
+        Prog1::CSR a = Prog1::input();
+        restore();
+        std::ostringstream out;
+        Prog1::write_dense(a, out);
+        EXPECT_EQ(out.str(), "0\t0\t-1\t\n0\t4\t0\t\n");
+    } catch (...) {
+        restore();
+        throw;
+    }
+}
@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Prog1.h"
+#include "Prog1elementwise.h"
+#include "Prog1hyb.h"
+#include "Prog1kernels.h"
+#include "Prog1reorder.h"
+#include "Prog1sell.h"
+#include "Prog1varint.h"
+#include "test_util.h"
+
+using namespace Prog1test;
+
+template<class T>
+class KernelTest : public ::testing::Test {};
+TYPED_TEST_SUITE(KernelTest, CsrTypes);
+
+namespace {
+    // large enough for the parallel paths, rows long enough for whole vector steps
+    template<class V, class I>
+    Prog1::BasicCSR<V, I> test_matrix(std::uint64_t seed) {
+        return random_csr<V, I>(3000, 1000, 0.02, seed);
+    }
+
+    template<class V>
+    std::vector<V> test_vector(std::size_t n) {
+        std::vector<V> x(n);
+        for (std::size_t j = 0; j < n; j++) {
+            x[j] = static_cast<V>(static_cast<int>(j % 7) - 3);
+        }
+        return x;
+    }
+}
+
+// the values are small integers, so vector and scalar sums are exact and must agree to the bit
+TYPED_TEST(KernelTest, SpmvFormatsMatchTheScalarPathAndTheReference) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = test_matrix<V, I>(1);
+    auto x = test_vector<V>(a.col);
+    auto expected = reference_spmv(a, x);
+
+    auto run = [&](auto&& spmv) {
+        return vector_and_scalar([&] {
+            std::vector<V> y(a.row, V{ 7 });
+            spmv(y.data());
+            return y;
+        });
+    };
+    auto csr = run([&](V* y) { Prog1::spmv(a, x.data(), y); });
+    auto sell = Prog1::build_sell(a);
+    auto sell_y = run([&](V* y) { Prog1::spmv(sell, x.data(), y); });
+    auto sell16 = Prog1::build_sell(a, I{ 16 }, I{ 64 });
+    auto sell16_y = run([&](V* y) { Prog1::spmv(sell16, x.data(), y); });
+    auto varint = Prog1::build_varint(a);
+    auto varint_y = run([&](V* y) { Prog1::spmv(varint, x.data(), y); });
+    // rows of 10+ elements become dense
+    auto hyb = Prog1::build_hybrid(a, 0.01);
+    EXPECT_GT(hyb.dense_count(), I{ 0 });
+    auto hyb_y = run([&](V* y) { Prog1::spmv(hyb, x.data(), y); });
+    for (auto* result : { &csr, &sell_y, &sell16_y, &varint_y, &hyb_y }) {
+        EXPECT_EQ(result->first, result->second);
+        EXPECT_EQ(result->first, expected);
+    }
+}
+
+// every row of a band starts far past column 127, which must not push the rows off the one-byte path
+TYPED_TEST(KernelTest, VarintOnABandedMatrix) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    Coo<V, I> m;
+    m.rows = m.cols = 2000;
+    for (I i = 0; i < m.rows; i++) {
+        for (I j = i < 8 ? 0 : i - 8; j <= i + 8 && j < m.cols; j++) {
+            m.row.push_back(i);
+            m.col.push_back(j);
+            m.val.push_back(static_cast<V>(static_cast<int>((i + j) % 5) - 2));
+        }
+    }
+    auto a = m.build();
+    auto x = test_vector<V>(a.col);
+    auto v = Prog1::build_varint(a);
+    // one byte per element and two offsets of sizeof(I) per row
+    EXPECT_EQ(v.arr_idx.size(), static_cast<std::size_t>(a.msize));
+    EXPECT_LT(v.index_bytes_per_nnz(), static_cast<double>(sizeof(I)));
+    auto y = vector_and_scalar([&] {
+        std::vector<V> out(a.row, V{ 7 });
+        Prog1::spmv(v, x.data(), out.data());
+        return out;
+    });
+    EXPECT_EQ(y.first, y.second);
+    EXPECT_EQ(y.first, reference_spmv(a, x));
+}
+
+// a few rows far above the density threshold among sparse ones; 150 columns take three mask words
+TYPED_TEST(KernelTest, HybridDenseRowsMatchCsr) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto m = random_coo<V, I>(200, 150, 0.03, 16);
+    // row 77 has its only minimum at column 140, row 199 is all equal values
+    auto dense_value = [](I i, I j) {
+        if (i == 77) {
+            return j == 140 ? V{ -9 } : static_cast<V>(static_cast<int>(j % 7) - 3);
+        }
+        return i == 199 ? V{ 2 } : static_cast<V>(static_cast<int>(j % 11) - 5);
+    };
+    for (I i : { I{ 0 }, I{ 77 }, I{ 199 } }) {
+        for (I j = 0; j < m.cols; j++) {
+            if (j % 10 != 3) {
+                m.row.push_back(i);
+                m.col.push_back(j);
+                m.val.push_back(dense_value(i, j));
+            }
+        }
+    }
+    auto a = m.build();
+    auto hyb = Prog1::build_hybrid(a);
+    ASSERT_EQ(hyb.dense_count(), I{ 3 });
+    EXPECT_EQ(hyb.msize, a.msize);
+    EXPECT_EQ(elements(Prog1::to_csr(hyb)), elements(a));
+    auto same_values = [&](const char* when) {
+        for (I i = 0; i < a.row; i++) {
+            for (I j = 0; j < a.col; j++) {
+                EXPECT_EQ(Prog1::get_value(hyb, i, j), Prog1::get_value(a, i, j)) << when << " (" << i << ", " << j << ")";
+            }
+        }
+    };
+    same_values("built");
+
+    Prog1::specialfunc(a);
+    Prog1::specialfunc(hyb);
+    EXPECT_EQ(hyb.dense_count(), I{ 3 });
+    EXPECT_EQ(hyb.msize, a.msize);
+    // the stored elements, zeros included, come from the masks
+    EXPECT_EQ(elements(Prog1::to_csr(hyb)), elements(a));
+    EXPECT_EQ(Prog1::get_value(hyb, I{ 77 }, I{ 139 }), V{ 0 });
+    EXPECT_EQ(Prog1::get_value(hyb, I{ 77 }, I{ 140 }), V{ -9 });
+    same_values("after specialfunc");
+}
+
+// SELL for rows of about the same length, CSR when a few long rows would make the chunks mostly padding
+// or when the rows are too short to fill a vector step
+TYPED_TEST(KernelTest, FormatSelectionAndAutoSpmv) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // lengths(i) elements in row i, spread over the columns
+    auto rows_of = [](I rows, I cols, auto lengths) {
+        Coo<V, I> m;
+        m.rows = rows;
+        m.cols = cols;
+        for (I i = 0; i < rows; i++) {
+            I n = lengths(i);
+            for (I k = 0; k < n; k++) {
+                m.row.push_back(i);
+                m.col.push_back(static_cast<I>((i * 7 + k * (cols / n)) % cols));
+                m.val.push_back(static_cast<V>(static_cast<int>((i + k) % 9) - 4));
+            }
+        }
+        return m.build();
+    };
+    auto uniform = rows_of(3000, 1000, [](I i) { return static_cast<I>(12 + i % 5); });
+    auto skewed = rows_of(3000, 1000, [](I i) { return static_cast<I>(i % 100 == 0 ? 900 : 1 + i % 3); });
+    auto short_rows = rows_of(3000, 1000, [](I) { return I{ 2 }; });
+    EXPECT_EQ(Prog1::choose_format(uniform), Prog1::SpmvFormat::sell);
+    EXPECT_EQ(Prog1::choose_format(skewed), Prog1::SpmvFormat::csr);
+    EXPECT_EQ(Prog1::choose_format(short_rows), Prog1::SpmvFormat::csr);
+    EXPECT_EQ(Prog1::choose_format(Prog1::BasicCSR<V, I>()), Prog1::SpmvFormat::csr);
+
+    for (auto* a : { &uniform, &skewed }) {
+        auto x = test_vector<V>(a->col);
+        auto expected = reference_spmv(*a, x);
+        Prog1::AutoSpmv<V, I> prepared(a->clone());
+        EXPECT_EQ(prepared.format(), a == &uniform ? Prog1::SpmvFormat::sell : Prog1::SpmvFormat::csr);
+        EXPECT_EQ(elements(prepared.csr()), elements(*a));
+        auto y = vector_and_scalar([&] {
+            std::vector<V> out(a->row, V{ 7 });
+            prepared.apply(x.data(), out.data());
+            return out;
+        });
+        EXPECT_EQ(y.first, y.second);
+        EXPECT_EQ(y.first, expected);
+    }
+}
+
+TYPED_TEST(KernelTest, SpmvAlphaBeta) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = test_matrix<V, I>(2);
+    auto x = test_vector<V>(a.col);
+    auto ax = reference_spmv(a, x);
+    std::vector<V> y(a.row, V{ 1 });
+    Prog1::spmv(a, x.data(), y.data(), V{ 2 }, V{ 3 });
+    for (I i = 0; i < a.row; i++) {
+        EXPECT_EQ(y[i], V{ 2 } * ax[i] + V{ 3 });
+    }
+}
+
+// every view of split_rows gives the rows of the whole matrix; one part is the whole matrix, two are past
+// parallel_min_nnz each
+TYPED_TEST(KernelTest, SplitRowViewsMatchTheWholeMatrix) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(6000, 1000, 0.015, 14);
+    auto x = test_vector<V>(a.col);
+    std::vector<V> y(a.row, V{ 1 }), y2(a.row, V{ 1 });
+    Prog1::spmv(a, x.data(), y.data());
+    Prog1::spmv(a, x.data(), y2.data(), V{ 2 }, V{ 3 });
+    auto min = Prog1::row_min(a), max = Prog1::row_max(a), sum = Prog1::row_sum(a);
+    auto nnz = Prog1::row_nnz(a), argmin = Prog1::row_argmin(a);
+    std::ostringstream whole;
+    Prog1::write_dense(a, whole);
+    for (int parts : { 1, 2, 7 }) {
+        auto views = Prog1::split_rows(a, parts);
+        ASSERT_EQ(views.size(), static_cast<std::size_t>(parts));
+        std::ostringstream pieces;
+        I next{ 0 };
+        for (auto& v : views) {
+            EXPECT_EQ(v.first_row, next);
+            next += v.row;
+            I f = v.first_row;
+            for (I i = 0; i < v.row; i += 13) {
+                for (I j = 0; j < a.col; j += 3) {
+                    EXPECT_EQ(Prog1::get_value(v, i, j), Prog1::get_value(a, f + i, j));
+                }
+            }
+            std::vector<V> vy(v.row, V{ 1 }), vy2(v.row, V{ 1 });
+            Prog1::spmv(v, x.data(), vy.data());
+            Prog1::spmv(v, x.data(), vy2.data(), V{ 2 }, V{ 3 });
+            EXPECT_TRUE(std::equal(vy.begin(), vy.end(), y.begin() + f));
+            EXPECT_TRUE(std::equal(vy2.begin(), vy2.end(), y2.begin() + f));
+            auto vmin = Prog1::row_min(v), vmax = Prog1::row_max(v), vsum = Prog1::row_sum(v);
+            auto vnnz = Prog1::row_nnz(v), vargmin = Prog1::row_argmin(v);
+            EXPECT_TRUE(std::equal(vmin.begin(), vmin.end(), min.begin() + f));
+            EXPECT_TRUE(std::equal(vmax.begin(), vmax.end(), max.begin() + f));
+            EXPECT_TRUE(std::equal(vsum.begin(), vsum.end(), sum.begin() + f));
+            EXPECT_TRUE(std::equal(vnnz.begin(), vnnz.end(), nnz.begin() + f));
+            // positions in the view's arrays, which start base elements into the matrix's
+            for (I i = 0; i < v.row; i++) {
+                EXPECT_EQ(vargmin[i] + v.base, argmin[f + i]);
+            }
+            Prog1::write_dense(v, pieces);
+        }
+        EXPECT_EQ(next, a.row);
+        EXPECT_EQ(pieces.str(), whole.str()) << parts << " parts";
+    }
+}
+
+TYPED_TEST(KernelTest, ViewRowRanges) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(50, 20, 0.2, 15);
+    Prog1::CSRView<V, I> whole(a);
+    EXPECT_THROW(whole.rows(I{ 10 }, I{ 51 }), std::runtime_error);
+    EXPECT_THROW(whole.rows(I{ 51 }, I{ 51 }), std::runtime_error);
+    EXPECT_THROW(whole.rows(I{ 30 }, I{ 20 }), std::runtime_error);
+    EXPECT_THROW((Prog1::CSRView<V, I>(a, I{ 5 }, I{ 4 })), std::runtime_error);
+
+    // ranges of a view are relative to it and checked against its own rows
+    auto middle = whole.rows(I{ 10 }, I{ 40 });
+    EXPECT_THROW(middle.rows(I{ 0 }, I{ 31 }), std::runtime_error);
+    auto inner = middle.rows(I{ 5 }, I{ 15 });
+    EXPECT_EQ(inner.first_row, I{ 15 });
+    EXPECT_EQ(inner.row, I{ 10 });
+    EXPECT_EQ(inner.msize, a.arr_row[25] - a.arr_row[15]);
+    for (I i = 0; i < inner.row; i++) {
+        for (I j = 0; j < a.col; j++) {
+            EXPECT_EQ(Prog1::get_value(inner, i, j), Prog1::get_value(a, i + 15, j));
+        }
+    }
+    auto none = middle.rows(I{ 30 }, I{ 30 });
+    EXPECT_EQ(none.row, I{ 0 });
+    EXPECT_EQ(none.msize, I{ 0 });
+    Prog1::BasicCSR<V, I> no_matrix;
+    auto empty = Prog1::CSRView<V, I>(no_matrix).rows(I{ 0 }, I{ 0 });
+    EXPECT_EQ(empty.row, I{ 0 });
+    EXPECT_THROW((Prog1::CSRView<V, I>(no_matrix).rows(I{ 0 }, I{ 1 })), std::runtime_error);
+}
+
+TYPED_TEST(KernelTest, ReductionsMatchTheScalarPathAndTheReference) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // long rows take the vector loops, the empty ones give 0
+    auto a = random_csr<V, I>(500, 400, 0.15, 3);
+    auto min = vector_and_scalar([&] { return Prog1::row_min(a); });
+    auto max = vector_and_scalar([&] { return Prog1::row_max(a); });
+    auto sum = vector_and_scalar([&] { return Prog1::row_sum(a); });
+    auto argmin = vector_and_scalar([&] { return Prog1::row_argmin(a); });
+    EXPECT_EQ(min.first, min.second);
+    EXPECT_EQ(max.first, max.second);
+    EXPECT_EQ(sum.first, sum.second);
+    EXPECT_EQ(argmin.first, argmin.second);
+    auto nnz = Prog1::row_nnz(a);
+    for (I i = 0; i < a.row; i++) {
+        I begin = a.arr_row[i], end = a.arr_row[i + 1];
+        EXPECT_EQ(nnz[i], end - begin);
+        if (begin == end) {
+            EXPECT_EQ(min.first[i], V{ 0 });
+            EXPECT_EQ(argmin.first[i], end);
+            continue;
+        }
+        auto first = a.arr_val.begin() + begin, last = a.arr_val.begin() + end;
+        EXPECT_EQ(min.first[i], *std::min_element(first, last));
+        EXPECT_EQ(max.first[i], *std::max_element(first, last));
+        V s{ 0 };
+        for (auto it = first; it != last; ++it) {
+            s += *it;
+        }
+        EXPECT_EQ(sum.first[i], s);
+        EXPECT_EQ(argmin.first[i], static_cast<I>(std::min_element(first, last) - a.arr_val.begin()));
+    }
+}
+
+TYPED_TEST(KernelTest, ElementwiseMatchesTheScalarPathAndTheReference) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // dense enough rows for the 8 x 8 common-column blocks
+    auto a = random_csr<V, I>(300, 200, 0.3, 4), b = random_csr<V, I>(300, 200, 0.3, 5);
+    auto ea = elements(a), eb = elements(b);
+    for (auto op : { Prog1::ElementOp::add, Prog1::ElementOp::subtract, Prog1::ElementOp::multiply,
+                     Prog1::ElementOp::min, Prog1::ElementOp::max }) {
+        auto c = vector_and_scalar([&] { return elements(Prog1::elementwise(a, b, op)); });
+        EXPECT_EQ(c.first, c.second);
+        std::map<std::pair<I, I>, V> expected;
+        auto combine = [&](V x, V y) {
+            switch (op) {
+            case Prog1::ElementOp::add: return x + y;
+            case Prog1::ElementOp::subtract: return x - y;
+            case Prog1::ElementOp::multiply: return x * y;
+            case Prog1::ElementOp::min: return std::min(x, y);
+            default: return std::max(x, y);
+            }
+        };
+        for (auto& [key, x] : ea) {
+            auto it = eb.find(key);
+            if (it != eb.end() || op != Prog1::ElementOp::multiply) {
+                expected[key] = combine(x, it == eb.end() ? V{ 0 } : it->second);
+            }
+        }
+        for (auto& [key, y] : eb) {
+            if (!ea.count(key) && op != Prog1::ElementOp::multiply) {
+                expected[key] = combine(V{ 0 }, y);
+            }
+        }
+        EXPECT_EQ(c.first, expected) << "op " << static_cast<int>(op);
+    }
+}
+
+TYPED_TEST(KernelTest, ElementwiseOfEmptyAndMismatchedMatrices) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    Prog1::BasicCSR<V, I> none;
+    auto c = Prog1::add(none, none);
+    EXPECT_EQ(c.row, I{ 0 });
+    EXPECT_EQ(c.msize, I{ 0 });
+
+    auto a = random_csr<V, I>(30, 20, 0.2, 8), b = random_csr<V, I>(30, 21, 0.2, 9);
+    EXPECT_THROW(Prog1::add(a, b), std::runtime_error);
+    EXPECT_THROW(Prog1::hadamard(a, none), std::runtime_error);
+    EXPECT_THROW(Prog1::hadamard(none, a), std::runtime_error);
+}
+
+TYPED_TEST(KernelTest, TransposeOfEmptyAndSingleRowMatrices) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    Prog1::BasicCSR<V, I> none;
+    auto t = Prog1::transpose(none);
+    EXPECT_EQ(t.row, I{ 0 });
+    EXPECT_EQ(t.col, I{ 0 });
+    EXPECT_EQ(t.msize, I{ 0 });
+
+    Prog1::BasicCSR<V, I> no_rows;
+    no_rows.allocate(0, 0);
+    no_rows.arr_row[0] = 0;
+    no_rows.col = 5;
+    t = Prog1::transpose(no_rows);
+    EXPECT_EQ(t.row, I{ 5 });
+    EXPECT_EQ(t.col, I{ 0 });
+    EXPECT_TRUE(is_canonical(t));
+
+    // one wide row, then a few wide rows past parallel_min_nnz: many more columns than elements
+    for (auto [rows, cols] : { std::pair{ 1, 5000 }, std::pair{ 8, 100000 } }) {
+        auto a = random_csr<V, I>(static_cast<I>(rows), static_cast<I>(cols), 0.05, 7);
+        t = Prog1::transpose(a);
+        EXPECT_EQ(t.row, static_cast<I>(cols));
+        EXPECT_EQ(t.col, static_cast<I>(rows));
+        EXPECT_TRUE(is_canonical(t));
+        std::map<std::pair<I, I>, V> flipped;
+        for (auto& [key, v] : elements(a)) {
+            flipped[{ key.second, key.first }] = v;
+        }
+        EXPECT_EQ(elements(t), flipped);
+    }
+}
+
+// the first column access from several threads at once builds the transpose once
+TYPED_TEST(KernelTest, CachedTransposeColumnOperations) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = test_matrix<V, I>(19);
+    std::vector<std::vector<V>> dense(a.row, std::vector<V>(a.col, V{ 0 }));
+    for (auto& [key, v] : elements(a)) {
+        dense[key.first][key.second] = v;
+    }
+    auto x = test_vector<V>(a.row);
+    std::vector<V> sums(a.col, V{ 0 }), atx(a.col, V{ 0 });
+    for (I i = 0; i < a.row; i++) {
+        for (I j = 0; j < a.col; j++) {
+            sums[j] += dense[i][j];
+            atx[j] += dense[i][j] * x[i];
+        }
+    }
+
+    Prog1::CSRWithTranspose<V, I> m(a.clone());
+    constexpr int threads = 6;
+    std::vector<const Prog1::BasicCSR<V, I>*> seen(threads);
+    std::vector<std::vector<V>> got_sums(threads, std::vector<V>(a.col)), got_atx(threads, std::vector<V>(a.col));
+    {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                // half of them start with a product, half with the sums
+                if (t % 2) {
+                    m.spmv_transposed(x.data(), got_atx[t].data());
+                    m.column_sums(got_sums[t].data());
+                } else {
+                    m.column_sums(got_sums[t].data());
+                    m.spmv_transposed(x.data(), got_atx[t].data());
+                }
+                seen[t] = &m.columns();
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        EXPECT_EQ(seen[t], &m.columns());
+        EXPECT_EQ(got_sums[t], sums);
+        EXPECT_EQ(got_atx[t], atx);
+    }
+    EXPECT_TRUE(is_canonical(m.columns()));
+    EXPECT_EQ(m.columns().row, a.col);
+    EXPECT_EQ(elements(m.rows()), elements(a));
+}
+
+TYPED_TEST(KernelTest, TransposeAndSpgemm) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(120, 80, 0.1, 6);
+    auto t = Prog1::transpose(a);
+    EXPECT_TRUE(is_canonical(t));
+    std::map<std::pair<I, I>, V> flipped;
+    for (auto& [key, v] : elements(a)) {
+        flipped[{ key.second, key.first }] = v;
+    }
+    EXPECT_EQ(elements(t), flipped);
+
+    auto c = Prog1::spgemm(a, t);
+    EXPECT_TRUE(is_canonical(c));
+    auto ea = elements(a);
+    for (I i = 0; i < c.row; i++) {
+        for (I j = 0; j < c.col; j += 7) {
+            V s{ 0 };
+            bool any = false;
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                auto it = ea.find({ j, a.arr_col[k] });
+                if (it != ea.end()) {
+                    s += a.arr_val[k] * it->second;
+                    any = true;
+                }
+            }
+            EXPECT_EQ(Prog1::get_value(c, i, j), any ? s : V{ 0 });
+        }
+    }
+}
+
+TEST(Reorder, DegreesCountEveryNeighbourOnce) {
+    // 0 <-> 1 stored both ways, 2 -> 3 and 3 -> 4 one way: degrees 1 1 1 2 1
+    int row[] = { 0, 1, 2, 3 }, col[] = { 1, 0, 3, 4 }, val[] = { 1, 1, 1, 1 };
+    auto a = Prog1::build_csr_from_coo<int, int>(5, 5, row, col, val, 4);
+    EXPECT_EQ(Prog1::reorder_permutation(a, Prog1::Reordering::degree), (std::vector<int>{ 0, 1, 2, 4, 3 }));
+
+    auto rcm = Prog1::reorder_permutation(a);
+    std::vector<int> sorted(rcm);
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(sorted, (std::vector<int>{ 0, 1, 2, 3, 4 }));
+}
+
+namespace {
+    // r -> the position of r in perm
+    template<class I>
+    std::vector<I> inverse(const std::vector<I>& perm) {
+        std::vector<I> inv(perm.size());
+        for (std::size_t r = 0; r < perm.size(); r++) {
+            inv[perm[r]] = static_cast<I>(r);
+        }
+        return inv;
+    }
+
+    // symmetric band of half width w, rows and columns then shuffled
+    template<class V, class I>
+    Prog1::BasicCSR<V, I> shuffled_band(I n, I w, std::uint64_t seed) {
+        Coo<V, I> m;
+        m.rows = m.cols = n;
+        for (I i = 0; i < n; i++) {
+            for (I j = i < w ? 0 : i - w; j <= i + w && j < n; j++) {
+                m.row.push_back(i);
+                m.col.push_back(j);
+                m.val.push_back(static_cast<V>(static_cast<int>((i + 2 * j) % 7) - 3));
+            }
+        }
+        std::vector<I> shuffle(n);
+        for (I i = 0; i < n; i++) {
+            shuffle[i] = i;
+        }
+        std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937_64(seed));
+        return Prog1::permute(m.build(), shuffle);
+    }
+}
+
+TYPED_TEST(KernelTest, PermutationsKeepSpmv) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = random_csr<V, I>(800, 800, 0.01, 17);
+    auto x = test_vector<V>(a.col);
+    auto expected = reference_spmv(a, x);
+    for (auto how : { Prog1::Reordering::rcm, Prog1::Reordering::degree }) {
+        auto perm = Prog1::reorder_permutation(a, how);
+        auto b = Prog1::permute(a, perm);
+        EXPECT_TRUE(is_canonical(b));
+        EXPECT_EQ(b.msize, a.msize);
+        // y = A * x through the permuted matrix
+        std::vector<V> px(a.col), py(a.row), y(a.row);
+        Prog1::permute_vector(perm, x.data(), px.data());
+        Prog1::spmv(b, px.data(), py.data());
+        Prog1::unpermute_vector(perm, py.data(), y.data());
+        EXPECT_EQ(y, expected);
+        // and back with the inverse permutation
+        auto back = Prog1::permute(b, inverse(perm));
+        EXPECT_EQ(elements(back), elements(a));
+        std::vector<V> back_y(a.row);
+        Prog1::spmv(back, x.data(), back_y.data());
+        EXPECT_EQ(back_y, expected);
+    }
+}
+
+TYPED_TEST(KernelTest, RcmNarrowsAShuffledBand) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto a = shuffled_band<V, I>(3000, 4, 18);
+    std::uint64_t shuffled = Prog1::bandwidth(a);
+    EXPECT_GT(shuffled, 1000u);
+    auto b = Prog1::permute(a, Prog1::reorder_permutation(a));
+    // a band of half width w comes back at most about 2w wide
+    EXPECT_LE(Prog1::bandwidth(b), 8u);
+    auto x = test_vector<V>(a.col);
+    auto perm = Prog1::reorder_permutation(a);
+    std::vector<V> px(a.col), py(a.row), y(a.row);
+    Prog1::permute_vector(perm, x.data(), px.data());
+    Prog1::spmv(b, px.data(), py.data());
+    Prog1::unpermute_vector(perm, py.data(), y.data());
+    EXPECT_EQ(y, reference_spmv(a, x));
+}
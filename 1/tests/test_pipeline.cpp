@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Prog1.h"
+#include "Prog1pipeline.h"
+#include "test_util.h"
+
+using namespace Prog1test;
+
+template<class T>
+class PipelineTest : public ::testing::Test {};
+TYPED_TEST_SUITE(PipelineTest, CsrTypes);
+
+namespace {
+    // the elements of every row as (col, value) in column order, passed through f(row, elements)
+    template<class V, class I, class F>
+    std::map<std::pair<I, I>, V> reference(const Prog1::BasicCSR<V, I>& a, F f) {
+        std::map<std::pair<I, I>, V> out;
+        for (I i = 0; i < a.row; i++) {
+            std::vector<std::pair<I, V>> row;
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                row.push_back({ a.arr_col[k], a.arr_val[k] });
+            }
+            f(i, row);
+            for (auto& [j, v] : row) {
+                out[{ i, j }] = v;
+            }
+        }
+        return out;
+    }
+
+    template<class V, class I, class Keep>
+    void keep_if(std::vector<std::pair<I, V>>& row, Keep keep) {
+        row.erase(std::remove_if(row.begin(), row.end(), [&](auto& e) { return !keep(e); }), row.end());
+    }
+
+    // the k largest values, the leftmost of the equal ones at the cut
+    template<class V, class I>
+    void top_k(std::vector<std::pair<I, V>>& row, std::size_t k) {
+        std::stable_sort(row.begin(), row.end(), [](auto& x, auto& y) { return x.second > y.second; });
+        row.resize(std::min(k, row.size()));
+        std::sort(row.begin(), row.end());
+    }
+
+    // from the first minimum to the end of the row
+    template<class V, class I>
+    void from_first_min(std::vector<std::pair<I, V>>& row) {
+        auto first = std::min_element(row.begin(), row.end(), [](auto& x, auto& y) { return x.second < y.second; });
+        row.erase(row.begin(), first);
+    }
+
+    // the small one for the edge cases, the large one past parallel_min_nnz; values in -5 .. 5, so many ties
+    template<class V, class I>
+    std::vector<Prog1::BasicCSR<V, I>> test_matrices() {
+        std::vector<Prog1::BasicCSR<V, I>> out;
+        out.push_back(random_csr<V, I>(60, 40, 0.3, 21));
+        out.push_back(random_csr<V, I>(3000, 1000, 0.02, 22));
+        return out;
+    }
+}
+
+TYPED_TEST(PipelineTest, ElementStages) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    for (auto& a : test_matrices<V, I>()) {
+        auto positive = a | Prog1::filter([](V v) { return v > V{ 0 }; }) | Prog1::compact();
+        EXPECT_TRUE(is_canonical(positive));
+        EXPECT_EQ(elements(positive), reference(a, [](I, auto& row) { keep_if<V, I>(row, [](auto& e) { return e.second > V{ 0 }; }); }));
+
+        auto below_diagonal = a | Prog1::filter([](I i, I j, V) { return j < i; }) | Prog1::compact();
+        EXPECT_EQ(elements(below_diagonal), reference(a, [](I i, auto& row) { keep_if<V, I>(row, [&](auto& e) { return e.first < i; }); }));
+
+        auto shifted = a | Prog1::transform([](I i, I j, V v) { return v + static_cast<V>((i + j) % 3); }) | Prog1::compact();
+        EXPECT_EQ(elements(shifted), reference(a, [](I i, auto& row) {
+            for (auto& [j, v] : row) {
+                v = v + static_cast<V>((i + j) % 3);
+            }
+        }));
+
+        auto large = a | Prog1::threshold(3) | Prog1::compact();
+        EXPECT_EQ(elements(large), reference(a, [](I, auto& row) {
+            keep_if<V, I>(row, [](auto& e) { return e.second >= V{ 3 } || e.second <= V{ -3 }; });
+        }));
+
+        // no stages: a copy
+        auto copy = a | Prog1::compact();
+        EXPECT_EQ(elements(copy), elements(a));
+    }
+}
+
+TYPED_TEST(PipelineTest, KeepTopKAndDropBeforeArgmin) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    for (auto& a : test_matrices<V, I>()) {
+        for (std::size_t k : { 0, 1, 3, 40 }) {
+            auto b = a | Prog1::keep_top_k(k) | Prog1::compact();
+            EXPECT_TRUE(is_canonical(b));
+            EXPECT_EQ(elements(b), reference(a, [&](I, auto& row) { top_k<V, I>(row, k); })) << "k " << k;
+        }
+        auto b = a | Prog1::drop_before_argmin() | Prog1::compact();
+        EXPECT_EQ(elements(b), reference(a, [](I, auto& row) { from_first_min<V, I>(row); }));
+    }
+}
+
+TYPED_TEST(PipelineTest, KeepTopKKeepsTheLeftmostTies) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // row 0: 1 3 2 3 3 -> the two leftmost 3s; row 1: 4 4 4 -> all of them; row 2: 5 2 2 1 -> 5 and the first 2
+    I row[] = { 0, 0, 0, 0, 0, 1, 1, 1, 2, 2, 2, 2 };
+    I col[] = { 0, 1, 2, 3, 4, 0, 2, 4, 0, 1, 2, 3 };
+    V val[] = { 1, 3, 2, 3, 3, 4, 4, 4, 5, 2, 2, 1 };
+    auto a = Prog1::build_csr_from_coo<V, I>(3, 5, row, col, val, 12);
+    auto b = a | Prog1::keep_top_k(2) | Prog1::compact();
+    std::map<std::pair<I, I>, V> expected{ { { 0, 1 }, 3 }, { { 0, 3 }, 3 }, { { 1, 0 }, 4 },
+                                           { { 1, 2 }, 4 }, { { 2, 0 }, 5 }, { { 2, 1 }, 2 } };
+    EXPECT_EQ(elements(b), expected);
+}
+
+// range, element and row stages in one pipeline, a range stage after a row stage runs on the buffer
+TYPED_TEST(PipelineTest, FusedStagesMatchOneStageAtATime) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto twice = [](V v) { return static_cast<V>(2 * v); };
+    auto odd_column = [](I, I j, V) { return j % 2 == 1; };
+    for (auto& a : test_matrices<V, I>()) {
+        auto fused = a | Prog1::drop_before_argmin() | Prog1::threshold(1) | Prog1::transform(twice)
+                       | Prog1::keep_top_k(3) | Prog1::filter(odd_column) | Prog1::compact();
+        EXPECT_TRUE(is_canonical(fused));
+        EXPECT_EQ(elements(fused), reference(a, [&](I, auto& row) {
+            from_first_min<V, I>(row);
+            keep_if<V, I>(row, [](auto& e) { return e.second >= V{ 1 } || e.second <= V{ -1 }; });
+            for (auto& e : row) {
+                e.second = twice(e.second);
+            }
+            top_k<V, I>(row, 3);
+            keep_if<V, I>(row, [](auto& e) { return e.first % 2 == 1; });
+        }));
+
+        auto row_then_range = a | Prog1::keep_top_k(4) | Prog1::drop_before_argmin() | Prog1::compact();
+        EXPECT_EQ(elements(row_then_range), reference(a, [](I, auto& row) {
+            top_k<V, I>(row, 4);
+            from_first_min<V, I>(row);
+        }));
+
+        // the stepwise result equals the fused one
+        auto first = a | Prog1::drop_before_argmin() | Prog1::threshold(1) | Prog1::compact();
+        auto second = first | Prog1::transform(twice) | Prog1::keep_top_k(3) | Prog1::compact();
+        auto stepwise = second | Prog1::filter(odd_column) | Prog1::compact();
+        EXPECT_EQ(elements(stepwise), elements(fused));
+    }
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Prog1stats.h"
+#include "test_util.h"
+
+namespace {
+    void sleep_ms(int ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+// the timers are used directly, so this holds with and without PROG1_STATS
+TEST(Stats, NestedTimersPauseTheOuterPhase) {
+    Prog1::stats().reset();
+    auto start = std::chrono::steady_clock::now();
+    {
+        Prog1::ScopedTimer parse(Prog1::Phase::parse);
+        sleep_ms(20);
+        {
+            Prog1::ScopedTimer build(Prog1::Phase::build);
+            sleep_ms(30);
+            // the same phase again is not counted twice
+            Prog1::ScopedTimer again(Prog1::Phase::build);
+            sleep_ms(10);
+        }
+        sleep_ms(20);
+    }
+    double wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double parse = Prog1::stats().milliseconds(Prog1::Phase::parse);
+    double build = Prog1::stats().milliseconds(Prog1::Phase::build);
+    EXPECT_GE(parse, 40.0);
+    EXPECT_GE(build, 40.0);
+    // without the pause the build time would be in the parse time as well
+    EXPECT_LE(parse + build, wall + 0.5);
+    EXPECT_EQ(Prog1::stats().milliseconds(Prog1::Phase::filter), 0.0);
+    Prog1::stats().reset();
+}
+
+TEST(Stats, Json) {
+    Prog1::stats().reset();
+    Prog1::stats().add_time(Prog1::Phase::filter, std::chrono::microseconds(1500));
+    Prog1::stats().add(Prog1::Counter::elements_built, 5);
+    Prog1::stats().add(Prog1::Counter::elements_built, 2);
+    Prog1::stats().add(Prog1::Counter::output_bytes, 1u << 20);
+    EXPECT_EQ(Prog1::stats().to_json(),
+              std::string("{\"enabled\": ") + (Prog1::CSRStats::enabled ? "true" : "false")
+              + ", \"phases_ms\": {\"parse\": 0.000, \"build\": 0.000, \"filter\": 1.500, \"output\": 0.000}, "
+                "\"counters\": {\"elements_built\": 7, \"duplicates_merged\": 0, \"elements_removed\": 0, "
+                "\"bytes_allocated\": 0, \"output_bytes\": 1048576}}");
+    Prog1::stats().reset();
+    EXPECT_EQ(Prog1::stats().count(Prog1::Counter::elements_built), 0u);
+}
@@ -0,0 +1,125 @@
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Prog1.h"
+#include "Prog1kernels.h"
+#include "Prog1trisolve.h"
+#include "test_util.h"
+
+using namespace Prog1test;
+
+template<class T>
+class TrisolveTest : public ::testing::Test {};
+TYPED_TEST_SUITE(TrisolveTest, CsrTypes);
+
+namespace {
+    // lower triangular in blocks of equal height: a row of block b refers to 3 rows of block b - 1, so
+    // every block is one level, wide enough (rows + elements >= 1 << 13) to be shared out between the threads.
+    // Integer matrices get a unit diagonal and +-1 elsewhere, so that the values stay small
+    template<class V, class I>
+    Prog1::BasicCSR<V, I> blocked_lower(I rows, I blocks, std::uint64_t seed) {
+        std::mt19937_64 gen(seed);
+        const I height = rows / blocks;
+        Coo<V, I> m;
+        m.rows = m.cols = rows;
+        for (I i = 0; i < rows; i++) {
+            I b = i / height;
+            if (b > 0) {
+                for (int r = 0; r < 3; r++) {
+                    m.row.push_back(i);
+                    m.col.push_back(static_cast<I>((b - 1) * height + gen() % height));
+                    m.val.push_back(std::is_floating_point_v<V> ? static_cast<V>(static_cast<int>(gen() % 9) - 4) / 4
+                                                               : static_cast<V>(gen() % 2 ? 1 : -1));
+                }
+            }
+            m.row.push_back(i);
+            m.col.push_back(i);
+            m.val.push_back(std::is_floating_point_v<V> ? static_cast<V>(2 + gen() % 3) : V{ 1 });
+        }
+        return m.build();
+    }
+
+    // the substitution the plain way, row after row; the same order of operations as the library
+    template<class V, class I>
+    std::vector<V> serial_solve(const Prog1::BasicCSR<V, I>& a, Prog1::Triangle uplo, const std::vector<V>& b) {
+        const std::size_t n = a.row;
+        std::vector<V> x(n);
+        for (std::size_t step = 0; step < n; step++) {
+            I i = static_cast<I>(uplo == Prog1::Triangle::lower ? step : n - 1 - step);
+            I begin = a.arr_row[i], end = a.arr_row[i + 1];
+            I diag = uplo == Prog1::Triangle::lower ? end - 1 : begin;
+            V sum = b[i];
+            for (I k = begin; k < end; k++) {
+                if (k != diag) {
+                    sum -= a.arr_val[k] * x[a.arr_col[k]];
+                }
+            }
+            x[i] = sum / a.arr_val[diag];
+        }
+        return x;
+    }
+}
+
+TYPED_TEST(TrisolveTest, WideLevelsMatchTheSerialSolve) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    // several pool threads are needed for the parallel path: ctest runs the tests with PROG1_THREADS set
+    auto lower = blocked_lower<V, I>(40000, 4, 31);
+    auto upper = Prog1::transpose(lower);
+    std::mt19937_64 gen(32);
+    std::vector<V> b(lower.row);
+    for (V& v : b) {
+        v = static_cast<V>(static_cast<int>(gen() % 11) - 5);
+    }
+
+    for (auto [a, uplo] : { std::pair{ &lower, Prog1::Triangle::lower }, std::pair{ &upper, Prog1::Triangle::upper } }) {
+        auto levels = Prog1::level_sets(*a, uplo);
+        ASSERT_EQ(levels.levels(), 4u);
+        for (std::size_t l = 0; l < levels.levels(); l++) {
+            I first = levels.level_ptr[l], last = levels.level_ptr[l + 1];
+            EXPECT_GE(static_cast<std::size_t>(last - first) + (levels.work[last] - levels.work[first]),
+                      std::size_t{ 1 } << 13);
+        }
+        std::vector<V> x(a->row);
+        Prog1::triangular_solve(*a, levels, b.data(), x.data());
+        EXPECT_EQ(x, serial_solve(*a, uplo, b));
+        if constexpr (std::is_floating_point_v<V>) {
+            std::vector<V> r = reference_spmv(*a, x);
+            for (std::size_t i = 0; i < r.size(); i++) {
+                ASSERT_NEAR(r[i], b[i], 1e-3 * (1 + std::abs(b[i]))) << "row " << i;
+            }
+        }
+
+        // in place, through the solver that keeps the levels
+        Prog1::TriangularSolver<V, I> solver(a->clone(), uplo);
+        std::vector<V> y(b);
+        solver.solve(y.data(), y.data());
+        EXPECT_EQ(y, x);
+    }
+}
+
+TYPED_TEST(TrisolveTest, MissingOrZeroDiagonalThrows) {
+    using V = typename TypeParam::value;
+    using I = typename TypeParam::index;
+    auto lower = blocked_lower<V, I>(40000, 4, 33);
+    std::vector<V> b(lower.row, V{ 1 }), x(lower.row);
+
+    // a zero in the last level, solved in parallel
+    auto zero = lower.clone();
+    zero.arr_val[zero.arr_row[zero.row] - 1] = V{ 0 };
+    EXPECT_THROW(Prog1::triangular_solve(zero, Prog1::Triangle::lower, b.data(), x.data()), std::runtime_error);
+
+    // row 1 without its diagonal, a matrix of the other triangle, levels of another matrix
+    I row[] = { 0, 1, 2, 2 }, col[] = { 0, 0, 1, 2 };
+    V val[] = { 1, 1, 1, 1 };
+    auto missing = Prog1::build_csr_from_coo<V, I>(3, 3, row, col, val, 4);
+    EXPECT_THROW(Prog1::level_sets(missing, Prog1::Triangle::lower), std::runtime_error);
+    EXPECT_THROW(Prog1::level_sets(lower, Prog1::Triangle::upper), std::runtime_error);
+    auto small = blocked_lower<V, I>(8, 2, 34);
+    EXPECT_THROW(Prog1::triangular_solve(lower, Prog1::level_sets(small, Prog1::Triangle::lower), b.data(), x.data()),
+                 std::runtime_error);
+}
@@ -0,0 +1,143 @@
+#ifndef OOPPROG1_TEST_UTIL_H
+#define OOPPROG1_TEST_UTIL_H
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "Prog1.h"
+#include "Prog1simd.h"
+
+namespace Prog1test {
+    // value and index type of a typed test
+    template<class V, class I>
+    struct Types {
+        using value = V;
+        using index = I;
+    };
+
+    using CsrTypes = ::testing::Types<Types<int, int>, Types<int, std::uint64_t>, Types<std::int64_t, int>,
+                                      Types<float, std::uint32_t>, Types<double, std::uint32_t>, Types<double, std::uint64_t>>;
+
+    // COO triples in input order; small integer values, so sums are exact in every value type
+    template<class V, class I>
+    struct Coo {
+        I rows{ 0 }, cols{ 0 };
+        std::vector<I> row, col;
+        std::vector<V> val;
+
+        Prog1::BasicCSR<V, I> build(Prog1::Duplicates dup = Prog1::Duplicates::sum) const {
+            return Prog1::build_csr_from_coo<V, I>(rows, cols, row.data(), col.data(), val.data(),
+                                                   static_cast<I>(val.size()), dup);
+        }
+    };
+
+    // about density * rows * cols random elements, a fraction of them repeating an earlier (row, col)
+    template<class V, class I>
+    Coo<V, I> random_coo(I rows, I cols, double density, std::uint64_t seed, double repeats = 0.1) {
+        std::mt19937_64 gen(seed);
+        Coo<V, I> m;
+        m.rows = rows;
+        m.cols = cols;
+        std::uint64_t count = static_cast<std::uint64_t>(density * static_cast<double>(rows) * static_cast<double>(cols));
+        for (std::uint64_t k = 0; k < count && rows > 0 && cols > 0; k++) {
+            if (!m.row.empty() && std::uniform_real_distribution<double>(0, 1)(gen) < repeats) {
+                std::size_t e = gen() % m.row.size();
+                m.row.push_back(m.row[e]);
+                m.col.push_back(m.col[e]);
+            } else {
+                m.row.push_back(static_cast<I>(gen() % rows));
+                m.col.push_back(static_cast<I>(gen() % cols));
+            }
+            m.val.push_back(static_cast<V>(static_cast<int>(gen() % 11) - 5));
+        }
+        return m;
+    }
+
+    template<class V, class I>
+    Prog1::BasicCSR<V, I> random_csr(I rows, I cols, double density, std::uint64_t seed) {
+        return random_coo<V, I>(rows, cols, density, seed).build();
+    }
+
+    // stored elements by (row, col)
+    template<class V, class I>
+    std::map<std::pair<I, I>, V> elements(const Prog1::BasicCSR<V, I>& a) {
+        std::map<std::pair<I, I>, V> out;
+        for (I i = 0; i < a.row; i++) {
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                out[{ i, a.arr_col[k] }] = a.arr_val[k];
+            }
+        }
+        return out;
+    }
+
+    // columns strictly increasing in every row, offsets consistent with msize
+    template<class V, class I>
+    ::testing::AssertionResult is_canonical(const Prog1::BasicCSR<V, I>& a) {
+        if (a.row == 0) {
+            return ::testing::AssertionSuccess();
+        }
+        if (a.arr_row[0] != 0 || a.arr_row[a.row] != a.msize) {
+            return ::testing::AssertionFailure() << "bad row offsets";
+        }
+        for (I i = 0; i < a.row; i++) {
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                if (a.arr_col[k] >= a.col || (k > a.arr_row[i] && a.arr_col[k] <= a.arr_col[k - 1])) {
+                    return ::testing::AssertionFailure() << "row " << i << " is not sorted or has a column out of range";
+                }
+            }
+        }
+        return ::testing::AssertionSuccess();
+    }
+
+    // y = A * x the plain way
+    template<class V, class I>
+    std::vector<V> reference_spmv(const Prog1::BasicCSR<V, I>& a, const std::vector<V>& x) {
+        std::vector<V> y(a.row, V{ 0 });
+        for (I i = 0; i < a.row; i++) {
+            for (I k = a.arr_row[i]; k < a.arr_row[i + 1]; k++) {
+                y[i] += a.arr_val[k] * x[a.arr_col[k]];
+            }
+        }
+        return y;
+    }
+
+    // f() with the vector kernels on and off (the second result is the scalar one)
+    template<class F>
+    auto vector_and_scalar(F f) {
+        auto vector = f();
+        Prog1::set_vector_kernels(false);
+        auto scalar = f();
+        Prog1::set_vector_kernels(true);
+        return std::make_pair(vector, scalar);
+    }
+
+    // file in the temporary directory, removed with the object
+    class TempFile {
+    public:
+        explicit TempFile(const std::string& name)
+            : path_((std::filesystem::temp_directory_path()
+                     / ("prog1_tests_" + std::to_string(::getpid()) + "_" + name)).string()) {}
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+        ~TempFile() {
+            std::error_code ignored;
+            std::filesystem::remove(path_, ignored);
+        }
+
+        const std::string& path() const { return path_; }
+
+    private:
+        std::string path_;
+    };
+}
+
+#endif //OOPPROG1_TEST_UTIL_H